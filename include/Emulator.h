@@ -1,27 +1,49 @@
 #pragma once
 
-#include <unordered_map>
-
 #ifdef EMULATION
 #include "nanovg.h"
 #include <GL/gl.h>
 #define NANOVG_GL3
 #include "nanovg_gl.h"
-std::unordered_map<NVGcontext *, void *> g_ContextUserPtrMap;
 
-inline NVGcontext *nvgCreateInternal(NVGparams *params) {
-  NVGcontext *ctx = nvgCreateGL3(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
-  if (ctx) {
-    g_ContextUserPtrMap[ctx] = (void *)params->userPtr;
+// Emulator extensions, implemented by the emulator executable
+
+// In idle mode the emulator stops rendering while nothing changes, call this from update/draw to keep animating
+extern "C" void fsEmulatorRequestRedraw(unsigned long long ctx);
+
+// Hot reload state. Export `bool <name>_gauge_save_state(unsigned long long ctx, sEmulatorStateBuffer *buffer)` to
+// snapshot state right before kill on a reload, then read it back during the next init to skip the cold start work.
+// fsEmulatorGetRestoredState returns nullptr on a cold start and its pointer is only valid until init returns.
+struct sEmulatorStateBuffer;
+extern "C" void fsEmulatorStateWrite(sEmulatorStateBuffer *buffer, const void *data, unsigned long size);
+extern "C" const void *fsEmulatorGetRestoredState(unsigned long long ctx, unsigned long *size);
+
+// File contents cached by the emulator across reloads, the pointer stays valid for the lifetime of the emulator
+extern "C" const unsigned char *fsEmulatorLoadResource(const char *path, unsigned long *size);
+
+inline int nvgCreateFontCached(NVGcontext *ctx, const char *name, const char *path) {
+  unsigned long size = 0;
+  const unsigned char *data = fsEmulatorLoadResource(path, &size);
+  if (!data) {
+    return -1;
   }
-  return ctx;
+  // freeData = 0, the emulator owns the bytes
+  return nvgCreateFontMem(ctx, name, const_cast<unsigned char *>(data), static_cast<int>(size), 0);
 }
-inline void *getUserPtr(NVGcontext *ctx) {
-  if (const auto it = g_ContextUserPtrMap.find(ctx);
-      it != g_ContextUserPtrMap.end()) {
-    return it->second;
-      }
-  return nullptr;
+inline int nvgCreateImageCached(NVGcontext *ctx, const char *path, int imageFlags) {
+  unsigned long size = 0;
+  const unsigned char *data = fsEmulatorLoadResource(path, &size);
+  if (!data) {
+    return 0;
+  }
+  return nvgCreateImageMem(ctx, imageFlags, const_cast<unsigned char *>(data), static_cast<int>(size));
 }
 
+// The emulator creates the context on its GL3 backend and keeps params->userPtr (the render callbacks are ignored)
+extern "C" NVGcontext *fsEmulatorCreateNVGContext(NVGparams *params);
+#define nvgCreateInternal(params) fsEmulatorCreateNVGContext(params)
+
+// nvgInternalParams(ctx)->userPtr is the emulator's backend struct, whose first member is the gauge's userPtr
+inline void *getUserPtr(NVGcontext *ctx) { return *static_cast<void **>(nvgInternalParams(ctx)->userPtr); }
+
 #endif
\ No newline at end of file
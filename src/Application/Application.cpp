@@ -2,17 +2,17 @@
 
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
-#include "nanovg.h"
-#define NANOVG_GL3_IMPLEMENTATION
+#include <algorithm>
 #include <chrono>
-#include <mutex>
+#include <span>
+#include <string_view>
 #include <thread>
 
 #include "GaugeLoader/GaugeLoader.hpp"
-#include "nanovg_gl.h"
 
 constexpr int FPS_CAP = 144;
-constexpr double FRAME_DURATION = 1.0 / FPS_CAP;
+constexpr int REDRAW_FRAMES = 3;
+constexpr double IDLE_TIMEOUT = 1.0;
 
 #include "Roboto-Regular.h"
 
@@ -20,7 +20,9 @@ Application *Application::s_Instance = nullptr;
 
 Application::Application(const ApplicationSpecifications &specifications)
     : m_Specification(specifications)
-    , m_Window(nullptr) {
+    , m_Window(nullptr)
+    , m_FramePacer(FramePacer::Mode::VSync, FPS_CAP)
+    , m_MainThreadId(std::this_thread::get_id()) {
   if (auto result = Init(); !result.has_value()) {
     result.error().Dispatch();
   }
@@ -52,6 +54,9 @@ std::expected<void, Application::Error> Application::Init() {
   }
 
   const auto version = SetupGLVersion();
+  if (m_Specification.hidden) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
 
   m_Window = glfwCreateWindow(static_cast<int>(m_Specification.window_size.first),
                               static_cast<int>(m_Specification.window_size.second), m_Specification.name.c_str(),
@@ -62,7 +67,7 @@ std::expected<void, Application::Error> Application::Init() {
   }
 
   glfwMakeContextCurrent(m_Window);
-  glfwSwapInterval(1);
+  // Swap interval is owned by the frame pacer and applied on the first frame
 
   if (glewInit() != GLEW_OK) {
     return std::unexpected(Error("Failed to initialize GLEW"));
@@ -147,6 +152,8 @@ std::expected<void, Application::Error> Application::Init() {
   style.ItemSpacing = ImVec2(8, 6);
   style.PopupBorderSize = 0.f;
 
+  // Installed before the ImGui backend so it chains to these instead of replacing them
+  InstallRedrawCallbacks();
   ImGui_ImplGlfw_InitForOpenGL(m_Window, true);
   ImGui_ImplOpenGL3_Init(version);
 
@@ -213,17 +220,12 @@ std::expected<void, Application::Error> Application::Run() {
   io.IniFilename = nullptr;
 
   while (!glfwWindowShouldClose(m_Window) && m_Running) {
-    const double start_time = glfwGetTime();
-    glfwPollEvents();
-    {
-      std::scoped_lock lock(m_EventQueueMutex);
-
-      while (!m_EventQueue.empty()) {
-        auto &func = m_EventQueue.front();
-        func();
-        m_EventQueue.pop();
-      }
+    if (!WaitForRedraw()) {
+      continue;
     }
+    m_FramePacer.BeginFrame(m_Window);
+    glfwPollEvents();
+    m_EventQueue.Drain();
     m_Layer->OnUpdate(m_TimeStep);
 
     ImGui_ImplOpenGL3_NewFrame();
@@ -258,6 +260,11 @@ std::expected<void, Application::Error> Application::Run() {
 
     ImGui::Render();
 
+    // Gauges render into their own framebuffers, which the ImGui draw data below samples
+    for (auto &gauge: GaugeLoader::GetInstance()->GetAllRenderers()) {
+      gauge.RenderContents();
+    }
+
     int display_w, display_h;
     glfwGetFramebufferSize(m_Window, &display_w, &display_h);
     glViewport(0, 0, display_w, display_h);
@@ -266,10 +273,7 @@ std::expected<void, Application::Error> Application::Run() {
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
-    for (auto &gauge: GaugeLoader::GetInstance()->GetAllRenderers()) {
-      gauge.RenderContents();
-    }
-
+    m_FramePacer.EndWork();
     glfwSwapBuffers(m_Window);
 
     const float time = GetTime();
@@ -281,18 +285,77 @@ std::expected<void, Application::Error> Application::Run() {
 #endif
     m_LastFrameTime = time;
 
-    const double endTime = glfwGetTime();
-
-    if (const double frameTime = endTime - start_time; frameTime < FRAME_DURATION) {
-      std::this_thread::sleep_for(std::chrono::duration<double>(FRAME_DURATION - frameTime));
-    }
+    m_FramePacer.EndFrame();
+    m_RenderedFrames++;
   }
   return {};
 }
 
+void Application::RequestRedraw() {
+  Application *app = s_Instance;
+  if (!app) {
+    return;
+  }
+  int frames = app->m_RedrawFrames.load();
+  while (frames < REDRAW_FRAMES && !app->m_RedrawFrames.compare_exchange_weak(frames, REDRAW_FRAMES)) {
+  }
+  if (app->m_IdleWaiting.load()) {
+    glfwPostEmptyEvent();
+  }
+}
+
+void Application::SetIdleRendering(bool enabled) {
+  m_IdleRendering = enabled;
+  RequestRedraw();
+}
+
+void Application::InstallRedrawCallbacks() {
+  glfwSetCursorPosCallback(m_Window, [](GLFWwindow *, double, double) { RequestRedraw(); });
+  glfwSetMouseButtonCallback(m_Window, [](GLFWwindow *, int, int, int) { RequestRedraw(); });
+  glfwSetScrollCallback(m_Window, [](GLFWwindow *, double, double) { RequestRedraw(); });
+  glfwSetKeyCallback(m_Window, [](GLFWwindow *, int, int, int, int) { RequestRedraw(); });
+  glfwSetCharCallback(m_Window, [](GLFWwindow *, unsigned int) { RequestRedraw(); });
+  glfwSetCursorEnterCallback(m_Window, [](GLFWwindow *, int) { RequestRedraw(); });
+  glfwSetWindowFocusCallback(m_Window, [](GLFWwindow *, int) { RequestRedraw(); });
+  glfwSetWindowSizeCallback(m_Window, [](GLFWwindow *, int, int) { RequestRedraw(); });
+  glfwSetFramebufferSizeCallback(m_Window, [](GLFWwindow *, int, int) { RequestRedraw(); });
+  glfwSetWindowRefreshCallback(m_Window, [](GLFWwindow *) { RequestRedraw(); });
+  glfwSetWindowIconifyCallback(m_Window, [](GLFWwindow *, int) { RequestRedraw(); });
+}
+
+bool Application::WaitForRedraw() {
+  if (!m_IdleRendering || GaugeLoader::GetInstance()->WantsContinuousRedraw()) {
+    return true;
+  }
+  if (m_RedrawFrames.load() > 0) {
+    m_RedrawFrames.fetch_sub(1);
+    return true;
+  }
+
+  // Nothing is dirty, block until an input event, a posted redraw request or the timeout. The flag and counter are
+  // sequentially consistent so a request racing with us either sees the flag and posts, or we see its counter.
+  m_IdleWaiting.store(true);
+  if (m_RedrawFrames.load() == 0) {
+    glfwWaitEventsTimeout(IDLE_TIMEOUT);
+  }
+  m_IdleWaiting.store(false);
+  m_IdleWakeups++;
+
+  if (m_RedrawFrames.load() == 0) {
+    return false;
+  }
+  // Don't count the time spent idle as a slow frame
+  m_FramePacer.ResetFrameClock();
+  return true;
+}
+
 std::unique_ptr<Application> Application::CreateApplication(int argc, char **argv, std::unique_ptr<Layer> layer) {
+  const bool hidden = std::ranges::any_of(std::span(argv, argc), [](const char *arg) {
+    return std::string_view(arg) == "--soak" || std::string_view(arg) == "--host-gauge";
+  });
   const auto specifications = ApplicationSpecifications{
-      "WASM Emulator", std::make_pair(1440, 1026), std::make_pair(3840, 2160), std::make_pair(1240, 680), true, false};
+      "WASM Emulator", std::make_pair(1440, 1026), std::make_pair(3840, 2160), std::make_pair(1240, 680), true, false,
+      hidden};
   auto app = std::make_unique<Application>(specifications);
   app->PushLayer(std::move(layer));
 
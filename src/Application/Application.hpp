@@ -2,14 +2,15 @@
 #define GLFW_INCLUDE_NONE
 #define GLFW_EXPOSE_NATIVE_WAYLAND
 
+#include <atomic>
 #include <expected>
 #include <functional>
 #include <imgui_internal.h>
 #include <iostream>
 #include <memory>
 #include <optional>
-#include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -17,6 +18,8 @@
 #include "GL/glew.h"
 //
 #include "GL/gl.h"
+#include "EventQueue.hpp"
+#include "FramePacer.hpp"
 #include "GLFW/glfw3.h"
 #include "Layer.hpp"
 #include "imgui.h"
@@ -31,6 +34,7 @@ class Application {
     std::pair<uint32_t, uint32_t> min_size;
     bool resizable;
     bool custom_titlebar;
+    bool hidden;  // headless runs (--soak) still need the GL context, but no visible window
   };
 
   struct Error {
@@ -67,11 +71,31 @@ class Application {
 
   static ImFont *GetFont(const std::string &name);
 
+  // Safe to call from any thread, the event runs on the main thread at the start of the next frame
   template<typename F>
   void QueueEvent(F &&func) {
-    m_EventQueue.push(func);
+    EventQueue::Event event(std::forward<F>(func));
+    while (!m_EventQueue.TryPush(event)) {
+      if (std::this_thread::get_id() == m_MainThreadId) {
+        // The main thread is the only consumer, waiting for room here would never end
+        event();
+        return;
+      }
+      std::this_thread::yield();
+    }
+    RequestRedraw();
   }
 
+  // Marks the UI dirty so the next few frames render even in idle mode. Safe to call from any thread.
+  static void RequestRedraw();
+  void SetIdleRendering(bool enabled);
+  bool IsIdleRendering() const { return m_IdleRendering; }
+  uint64_t GetIdleWakeups() const { return m_IdleWakeups; }
+  uint64_t GetRenderedFrames() const { return m_RenderedFrames; }
+
+  const EventQueue &GetEventQueue() const { return m_EventQueue; }
+  FramePacer &GetFramePacer() { return m_FramePacer; }
+
   static std::optional<Application *> Get();
 
   ApplicationSpecifications GetSpecifications() { return m_Specification; }
@@ -82,6 +106,8 @@ class Application {
   std::expected<void, Error> Shutdown();
 
   static void GLFWErrorCallback(int error, const char *description);
+  void InstallRedrawCallbacks();
+  bool WaitForRedraw();
 
   private:
   ApplicationSpecifications m_Specification;
@@ -96,9 +122,17 @@ class Application {
   float m_TimeStep = 0.0f;
   float m_FrameTime = 0.0f;
   float m_LastFrameTime = 0.0f;
+  FramePacer m_FramePacer;
+
+  // Frames left to render before idle mode may block again, input keeps a few frames so ImGui can settle
+  std::atomic<int> m_RedrawFrames = 1;
+  std::atomic<bool> m_IdleWaiting = false;
+  bool m_IdleRendering = false;
+  uint64_t m_IdleWakeups = 0;
+  uint64_t m_RenderedFrames = 0;
 
   std::shared_ptr<Layer> m_Layer;
 
-  std::mutex m_EventQueueMutex;
-  std::queue<std::function<void()>> m_EventQueue;
+  std::thread::id m_MainThreadId;
+  EventQueue m_EventQueue;
 };
@@ -0,0 +1,259 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only void() callable with inline storage. Captures up to Capacity bytes live inside the object, anything larger
+// falls back to a single heap allocation.
+template<size_t Capacity = 64>
+class SmallFunction {
+  public:
+  SmallFunction() = default;
+
+  template<typename F>
+    requires(!std::is_same_v<std::decay_t<F>, SmallFunction> && std::is_invocable_v<std::decay_t<F> &>)
+  SmallFunction(F &&func) {  // NOLINT(google-explicit-constructor)
+    using T = std::decay_t<F>;
+    if constexpr (FitsInline<T>) {
+      new (m_Storage) T(std::forward<F>(func));
+      m_Ops = &InlineOps<T>;
+    } else {
+      *reinterpret_cast<T **>(m_Storage) = new T(std::forward<F>(func));
+      m_Ops = &HeapOps<T>;
+    }
+  }
+
+  SmallFunction(SmallFunction &&other) noexcept { MoveFrom(other); }
+
+  SmallFunction &operator=(SmallFunction &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  SmallFunction(const SmallFunction &) = delete;
+  SmallFunction &operator=(const SmallFunction &) = delete;
+
+  ~SmallFunction() { Reset(); }
+
+  void operator()() { m_Ops->invoke(m_Storage); }
+
+  explicit operator bool() const { return m_Ops != nullptr; }
+  bool IsHeapAllocated() const { return m_Ops && m_Ops->heap; }
+
+  void Reset() {
+    if (m_Ops) {
+      m_Ops->destroy(m_Storage);
+      m_Ops = nullptr;
+    }
+  }
+
+  private:
+  struct Ops {
+    void (*invoke)(void *storage);
+    void (*move)(void *dst, void *src);
+    void (*destroy)(void *storage);
+    bool heap;
+  };
+
+  template<typename T>
+  static constexpr bool FitsInline = sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<T>;
+
+  template<typename T>
+  static constexpr Ops InlineOps{
+      [](void *storage) { (*std::launder(reinterpret_cast<T *>(storage)))(); },
+      [](void *dst, void *src) {
+        T *source = std::launder(reinterpret_cast<T *>(src));
+        new (dst) T(std::move(*source));
+        source->~T();
+      },
+      [](void *storage) { std::launder(reinterpret_cast<T *>(storage))->~T(); },
+      false,
+  };
+
+  template<typename T>
+  static constexpr Ops HeapOps{
+      [](void *storage) { (**reinterpret_cast<T **>(storage))(); },
+      [](void *dst, void *src) { *reinterpret_cast<T **>(dst) = *reinterpret_cast<T **>(src); },
+      [](void *storage) { delete *reinterpret_cast<T **>(storage); },
+      true,
+  };
+
+  void MoveFrom(SmallFunction &other) {
+    if (other.m_Ops) {
+      other.m_Ops->move(m_Storage, other.m_Storage);
+      m_Ops = other.m_Ops;
+      other.m_Ops = nullptr;
+    }
+  }
+
+  private:
+  alignas(std::max_align_t) unsigned char m_Storage[Capacity];
+  const Ops *m_Ops = nullptr;
+};
+
+// Bounded lock-free multi-producer / single-consumer queue of SmallFunctions (Vyukov's sequence-numbered ring).
+// Producers never take a lock and the consumer releases each slot before running the callable, so a slow event never
+// holds up a producer.
+class EventQueue {
+  public:
+  using Event = SmallFunction<64>;
+
+  struct Stats {
+    uint64_t enqueued;
+    uint64_t executed;
+    uint64_t full_retries;
+    uint64_t heap_events;
+    double avg_enqueue_ns;  // cost of TryPush for the producer
+    double max_enqueue_ns;
+    double avg_wait_us;  // time spent sitting in the queue before the main thread ran it
+    double max_wait_us;
+    size_t depth;
+    size_t max_depth;
+    size_t capacity;
+  };
+
+  explicit EventQueue(size_t capacity = 1024) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_Mask = size - 1;
+    m_Cells = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+      m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  EventQueue(const EventQueue &) = delete;
+  EventQueue &operator=(const EventQueue &) = delete;
+
+  // Returns false when the ring is full, the event is left untouched in that case
+  bool TryPush(Event &event) {
+    const uint64_t start = NowNs();
+    size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &m_Cells[pos & m_Mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        m_FullRetries.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = m_EnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    if (event.IsHeapAllocated()) {
+      m_HeapEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+    cell->event = std::move(event);
+    const uint64_t end = NowNs();
+    cell->enqueued_ns = end;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    const uint64_t elapsed = end - start;
+    m_Enqueued.fetch_add(1, std::memory_order_relaxed);
+    m_EnqueueNsTotal.fetch_add(elapsed, std::memory_order_relaxed);
+    uint64_t max = m_EnqueueNsMax.load(std::memory_order_relaxed);
+    while (elapsed > max && !m_EnqueueNsMax.compare_exchange_weak(max, elapsed, std::memory_order_relaxed)) {
+    }
+    return true;
+  }
+
+  // Consumer side, must only be called from one thread. Runs at most the events that were queued when the drain
+  // started so an event that re-queues itself can't stall the frame.
+  size_t Drain() {
+    const size_t depth = m_EnqueuePos.load(std::memory_order_acquire) - m_DequeuePos;
+    m_Depth.store(depth, std::memory_order_relaxed);
+    if (depth > m_MaxDepth.load(std::memory_order_relaxed)) {
+      m_MaxDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    size_t executed = 0;
+    while (executed < depth) {
+      Cell &cell = m_Cells[m_DequeuePos & m_Mask];
+      if (cell.sequence.load(std::memory_order_acquire) != m_DequeuePos + 1) {
+        break;  // slot claimed but the producer hasn't finished writing it yet
+      }
+      Event event = std::move(cell.event);
+      const uint64_t waited = NowNs() - cell.enqueued_ns;
+      cell.sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+      ++m_DequeuePos;
+
+      event();
+
+      m_WaitNsTotal.fetch_add(waited, std::memory_order_relaxed);
+      if (waited > m_WaitNsMax.load(std::memory_order_relaxed)) {
+        m_WaitNsMax.store(waited, std::memory_order_relaxed);
+      }
+      m_Executed.fetch_add(1, std::memory_order_relaxed);
+      ++executed;
+    }
+    return executed;
+  }
+
+  Stats GetStats() const {
+    const uint64_t enqueued = m_Enqueued.load(std::memory_order_relaxed);
+    const uint64_t executed = m_Executed.load(std::memory_order_relaxed);
+    return Stats{
+        enqueued,
+        executed,
+        m_FullRetries.load(std::memory_order_relaxed),
+        m_HeapEvents.load(std::memory_order_relaxed),
+        enqueued ? static_cast<double>(m_EnqueueNsTotal.load(std::memory_order_relaxed)) / enqueued : 0.0,
+        static_cast<double>(m_EnqueueNsMax.load(std::memory_order_relaxed)),
+        executed ? static_cast<double>(m_WaitNsTotal.load(std::memory_order_relaxed)) / executed / 1e3 : 0.0,
+        static_cast<double>(m_WaitNsMax.load(std::memory_order_relaxed)) / 1e3,
+        m_Depth.load(std::memory_order_relaxed),
+        m_MaxDepth.load(std::memory_order_relaxed),
+        m_Mask + 1,
+    };
+  }
+
+  private:
+  static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence{0};
+    uint64_t enqueued_ns = 0;
+    Event event;
+  };
+
+  private:
+  std::unique_ptr<Cell[]> m_Cells;
+  size_t m_Mask = 0;
+
+  alignas(64) std::atomic<size_t> m_EnqueuePos{0};
+  std::atomic<uint64_t> m_Enqueued{0};
+  std::atomic<uint64_t> m_EnqueueNsTotal{0};
+  std::atomic<uint64_t> m_EnqueueNsMax{0};
+  std::atomic<uint64_t> m_FullRetries{0};
+  std::atomic<uint64_t> m_HeapEvents{0};
+
+  // Consumer owned
+  alignas(64) size_t m_DequeuePos = 0;
+  std::atomic<uint64_t> m_Executed{0};
+  std::atomic<size_t> m_Depth{0};
+  std::atomic<size_t> m_MaxDepth{0};
+  std::atomic<uint64_t> m_WaitNsTotal{0};
+  std::atomic<uint64_t> m_WaitNsMax{0};
+};
@@ -0,0 +1,192 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "GLFW/glfw3.h"
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+FramePacer::FramePacer(Mode mode, int target_fps)
+    : m_Mode(mode)
+    , m_TargetFps(target_fps) {}
+
+void FramePacer::SetMode(Mode mode) {
+  if (mode == m_Mode) {
+    return;
+  }
+  m_Mode = mode;
+  m_SwapIntervalDirty = true;
+  m_NextDeadline = {};
+  ResetStats();
+}
+
+void FramePacer::SetTargetFps(int fps) {
+  m_TargetFps = std::clamp(fps, MIN_TARGET_FPS, MAX_TARGET_FPS);
+  m_NextDeadline = {};
+  ResetStats();
+}
+
+void FramePacer::BeginFrame(GLFWwindow *window) {
+  if (m_SwapIntervalDirty) {
+    glfwSwapInterval(m_Mode == Mode::VSync || m_Mode == Mode::Latency ? 1 : 0);
+    m_SwapIntervalDirty = false;
+  }
+
+  if (m_Mode == Mode::Latency && m_LastPresent != Clock::time_point{}) {
+    // Swap returned at (roughly) the last vblank. Sample input as late as possible while still finishing the frame
+    // before the next one, keeping a margin so a slightly slow frame doesn't miss it entirely.
+    const double refresh = GetRefreshInterval(window);
+    const double margin = std::max(0.001, m_PredictedWork * 0.25);
+    const double delay = refresh - m_PredictedWork - margin;
+    if (delay > 0.0) {
+      WaitUntil(m_LastPresent + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay)));
+    }
+  }
+
+  m_WorkStart = Clock::now();
+}
+
+void FramePacer::EndWork() {
+  const double work = std::chrono::duration<double>(Clock::now() - m_WorkStart).count();
+  m_PredictedWork = m_PredictedWork == 0.0 ? work : m_PredictedWork * 0.9 + work * 0.1;
+}
+
+void FramePacer::EndFrame() {
+  auto now = Clock::now();
+
+  if (m_Mode == Mode::FixedCap) {
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(GetTargetInterval()));
+    // Deadlines advance by a fixed period so sleep error doesn't accumulate, resync if we fell a whole frame behind
+    if (m_NextDeadline == Clock::time_point{} || now - m_NextDeadline > period) {
+      m_NextDeadline = now + period;
+    }
+    WaitUntil(m_NextDeadline);
+    m_NextDeadline += period;
+    now = Clock::now();
+  }
+
+  if (m_LastPresent != Clock::time_point{}) {
+    const double interval = std::chrono::duration<double>(now - m_LastPresent).count();
+    if (m_Mode == Mode::VSync || m_Mode == Mode::Latency) {
+      // Track the display's refresh rate from presents that landed near one vblank
+      if (m_RefreshInterval == 0.0) {
+        m_RefreshInterval = interval;
+      } else if (interval < m_RefreshInterval * 1.5) {
+        m_RefreshInterval = m_RefreshInterval * 0.95 + interval * 0.05;
+      }
+    }
+    RecordInterval(interval);
+  }
+  m_LastPresent = now;
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline) {
+  // Sleep for the bulk of the wait, the scheduler can overshoot by a lot so the last stretch is spun
+  auto now = Clock::now();
+  const auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_SpinThreshold));
+  if (deadline - now > spin) {
+    const auto target = deadline - spin;
+    std::this_thread::sleep_until(target);
+    now = Clock::now();
+
+    // Adapt the spin window to how late sleeps actually wake up on this machine
+    const double overshoot = std::max(0.0, std::chrono::duration<double>(now - target).count());
+    m_SleepOvershoot = std::max(overshoot, m_SleepOvershoot * 0.98);
+    m_SpinThreshold = std::clamp(m_SleepOvershoot * 1.5, 0.0002, 0.004);
+  }
+  while (Clock::now() < deadline) {
+    cpu_relax();
+  }
+}
+
+double FramePacer::GetRefreshInterval(GLFWwindow *window) const {
+  if (m_RefreshInterval > 0.0) {
+    return m_RefreshInterval;
+  }
+  GLFWmonitor *monitor = glfwGetWindowMonitor(window);
+  if (!monitor) {
+    monitor = glfwGetPrimaryMonitor();
+  }
+  if (monitor) {
+    if (const GLFWvidmode *mode = glfwGetVideoMode(monitor); mode && mode->refreshRate > 0) {
+      return 1.0 / mode->refreshRate;
+    }
+  }
+  return 1.0 / 60.0;
+}
+
+double FramePacer::GetTargetInterval() const {
+  switch (m_Mode) {
+    case Mode::FixedCap:
+      return 1.0 / m_TargetFps;
+    case Mode::VSync:
+    case Mode::Latency:
+      return m_RefreshInterval;
+    case Mode::Uncapped:
+    default:
+      return 0.0;
+  }
+}
+
+void FramePacer::RecordInterval(double interval) {
+  const double interval_ms = interval * 1e3;
+  m_FrameTimes[m_FrameTimesHead] = static_cast<float>(interval_ms);
+  m_FrameTimesHead = (m_FrameTimesHead + 1) % HISTORY_SIZE;
+
+  m_Frames++;
+  m_Sum += interval_ms;
+  m_SumSquares += interval_ms * interval_ms;
+
+  // Uncapped frames have no target, measure their jitter against the running mean instead
+  double target_ms = GetTargetInterval() * 1e3;
+  if (target_ms <= 0.0) {
+    target_ms = m_Sum / m_Frames;
+  }
+  const double deviation_us = (interval_ms - target_ms) * 1e3;
+  const int bin = std::clamp(static_cast<int>(std::lround(deviation_us / JITTER_BIN_US)) + JITTER_BINS / 2, 0,
+                             JITTER_BINS - 1);
+  m_JitterHistogram[bin] += 1.0f;
+  m_WorstLate = std::max(m_WorstLate, interval_ms - target_ms);
+}
+
+void FramePacer::ResetStats() {
+  m_JitterHistogram.fill(0.0f);
+  m_FrameTimes.fill(0.0f);
+  m_FrameTimesHead = 0;
+  m_Frames = 0;
+  m_Sum = 0.0;
+  m_SumSquares = 0.0;
+  m_WorstLate = 0.0;
+  m_LastPresent = {};
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+  const double mean = m_Frames ? m_Sum / m_Frames : 0.0;
+  const double variance = m_Frames ? std::max(0.0, m_SumSquares / m_Frames - mean * mean) : 0.0;
+  return Stats{
+      GetTargetInterval() * 1e3, mean, std::sqrt(variance), m_WorstLate, m_SpinThreshold * 1e3, m_PredictedWork * 1e3,
+      m_Frames,
+  };
+}
+
+const char *FramePacer::ModeName(Mode mode) {
+  switch (mode) {
+    case Mode::VSync:
+      return "VSync";
+    case Mode::Uncapped:
+      return "Uncapped (benchmark)";
+    case Mode::FixedCap:
+      return "Fixed cap";
+    case Mode::Latency:
+      return "Low latency";
+  }
+  return "Unknown";
+}
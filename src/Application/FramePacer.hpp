@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+struct GLFWwindow;
+
+// Decides how long the main loop waits between frames and keeps a histogram of how far each frame landed from its
+// target so pacing precision can be checked in the instrumentation panel.
+class FramePacer {
+  public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Mode {
+    VSync,  // swap interval 1, the driver does the waiting
+    Uncapped,  // swap interval 0, no waiting at all (benchmarking)
+    FixedCap,  // swap interval 0, hybrid sleep + spin to the target rate
+    Latency,  // swap interval 1, input sampling is delayed until just before the predicted start of work
+  };
+
+  static constexpr int JITTER_BINS = 41;
+  static constexpr double JITTER_BIN_US = 100.0;  // bins cover -2ms .. +2ms around the target, ends are open
+  static constexpr size_t HISTORY_SIZE = 256;
+  static constexpr int MIN_TARGET_FPS = 30;
+  static constexpr int MAX_TARGET_FPS = 500;
+
+  struct Stats {
+    double target_ms;  // 0 when the mode has no target (uncapped)
+    double mean_ms;
+    double stddev_ms;
+    double worst_late_ms;
+    double spin_threshold_ms;
+    double predicted_work_ms;
+    uint64_t frames;
+  };
+
+  explicit FramePacer(Mode mode = Mode::VSync, int target_fps = 144);
+
+  void SetMode(Mode mode);
+  Mode GetMode() const { return m_Mode; }
+  void SetTargetFps(int fps);
+  int GetTargetFps() const { return m_TargetFps; }
+
+  // Call before sampling input. Applies pending swap interval changes and, in latency mode, waits until the last
+  // moment that still leaves room for the predicted CPU work before the next vblank.
+  void BeginFrame(GLFWwindow *window);
+  // Call right before glfwSwapBuffers, so the work prediction doesn't include the swap's vsync wait
+  void EndWork();
+  // Call right after glfwSwapBuffers. Records the frame and in fixed cap mode waits for the next deadline.
+  void EndFrame();
+
+  void ResetStats();
+  // Forget the previous present, used after the main loop sat idle so the gap isn't recorded as a frame
+  void ResetFrameClock() { m_LastPresent = {}; }
+  Stats GetStats() const;
+  const std::array<float, JITTER_BINS> &GetJitterHistogram() const { return m_JitterHistogram; }
+  // Frame intervals in ms, oldest first once the ring has wrapped
+  const std::array<float, HISTORY_SIZE> &GetFrameTimes() const { return m_FrameTimes; }
+  size_t GetFrameTimesOffset() const { return m_FrameTimesHead; }
+
+  static const char *ModeName(Mode mode);
+
+  private:
+  void WaitUntil(Clock::time_point deadline);
+  double GetRefreshInterval(GLFWwindow *window) const;
+  double GetTargetInterval() const;
+  void RecordInterval(double interval);
+
+  private:
+  Mode m_Mode;
+  int m_TargetFps;
+  bool m_SwapIntervalDirty = true;
+
+  Clock::time_point m_LastPresent{};
+  Clock::time_point m_WorkStart{};
+  Clock::time_point m_NextDeadline{};
+
+  double m_RefreshInterval = 0.0;  // seconds, measured from vsync'd presents
+  double m_PredictedWork = 0.0;  // seconds, EMA of input sample -> present
+  double m_SpinThreshold = 0.001;  // seconds left on the clock when we stop sleeping and start spinning
+  double m_SleepOvershoot = 0.0;
+
+  std::array<float, JITTER_BINS> m_JitterHistogram{};
+  std::array<float, HISTORY_SIZE> m_FrameTimes{};
+  size_t m_FrameTimesHead = 0;
+
+  uint64_t m_Frames = 0;
+  double m_Sum = 0.0;
+  double m_SumSquares = 0.0;
+  double m_WorstLate = 0.0;
+};
@@ -0,0 +1,36 @@
+#include "BenchmarkReport.hpp"
+
+#include <chrono>
+#include <fstream>
+
+#include "nlohmann/json.hpp"
+
+BenchmarkReport *BenchmarkReport::m_Instance = nullptr;
+
+void BenchmarkReport::Add(const std::string &name, const double value, const std::string &unit) {
+  for (auto &result: m_Results) {
+    if (result.name == name) {
+      result.value = value;
+      result.unit = unit;
+      return;
+    }
+  }
+  m_Results.push_back(Result{name, value, unit});
+}
+
+std::expected<void, std::string> BenchmarkReport::WriteJson(const std::string &path) const {
+  nlohmann::json json;
+  json["timestamp"] =
+      std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  json["results"] = nlohmann::json::array();
+  for (const auto &result: m_Results) {
+    json["results"].push_back({{"name", result.name}, {"value", result.value}, {"unit", result.unit}});
+  }
+
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return std::unexpected("Failed to open " + path);
+  }
+  file << json.dump(2) << std::endl;
+  return {};
+}
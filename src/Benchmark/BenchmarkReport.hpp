@@ -0,0 +1,35 @@
+#pragma once
+#include <expected>
+#include <string>
+#include <vector>
+
+// Named measurements collected from the emulator's microbenchmarks and profilers, exportable as JSON so runs can be
+// diffed between builds
+class BenchmarkReport {
+  public:
+  struct Result {
+    std::string name;
+    double value;
+    std::string unit;
+  };
+
+  static BenchmarkReport *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new BenchmarkReport();
+    }
+    return m_Instance;
+  }
+
+  // Replaces an earlier result of the same name
+  void Add(const std::string &name, double value, const std::string &unit);
+  const std::vector<Result> &GetResults() const { return m_Results; }
+  void Clear() { m_Results.clear(); }
+
+  std::expected<void, std::string> WriteJson(const std::string &path) const;
+
+  private:
+  BenchmarkReport() = default;
+
+  static BenchmarkReport *m_Instance;
+  std::vector<Result> m_Results;
+};
@@ -0,0 +1,60 @@
+#include "NvgUserPtrBenchmark.hpp"
+
+#include "BenchmarkReport.hpp"
+#include "FsShims/FsNanoVG.hpp"
+//
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+static constexpr int CONTEXT_COUNT = 16;  // a busy cockpit, every gauge owns one context
+static constexpr int LOOKUPS = 1 << 22;
+
+template<typename F>
+static double measure_ns_per_lookup(const std::vector<NVGcontext *> &contexts, F &&lookup) {
+  uintptr_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    sink += reinterpret_cast<uintptr_t>(lookup(contexts[i & (CONTEXT_COUNT - 1)]));
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  asm volatile("" : : "r"(sink) : "memory");
+  return std::chrono::duration<double, std::nano>(elapsed).count() / LOOKUPS;
+}
+
+void NvgUserPtrBenchmark::Run(BenchmarkReport &report) {
+  std::vector<NVGcontext *> contexts;
+  std::unordered_map<NVGcontext *, void *> legacy_map;
+  for (int i = 0; i < CONTEXT_COUNT; i++) {
+    NVGparams params{};
+    params.userPtr = reinterpret_cast<void *>(static_cast<uintptr_t>(i + 1));
+    params.edgeAntiAlias = 1;
+    NVGcontext *ctx = fsEmulatorCreateNVGContext(&params);
+    if (!ctx) {
+      std::cerr << "[Benchmark] Failed to create NanoVG context" << std::endl;
+      break;
+    }
+    contexts.push_back(ctx);
+    legacy_map[ctx] = params.userPtr;
+  }
+
+  if (contexts.size() == CONTEXT_COUNT) {
+    const double legacy_ns = measure_ns_per_lookup(contexts, [&legacy_map](NVGcontext *ctx) -> void * {
+      const auto it = legacy_map.find(ctx);
+      return it != legacy_map.end() ? it->second : nullptr;
+    });
+    const double side_struct_ns = measure_ns_per_lookup(
+        contexts, [](NVGcontext *ctx) { return *static_cast<void **>(nvgInternalParams(ctx)->userPtr); });
+
+    report.Add("nvg_user_ptr.unordered_map", legacy_ns, "ns/lookup");
+    report.Add("nvg_user_ptr.side_struct", side_struct_ns, "ns/lookup");
+    std::cout << "[Benchmark] getUserPtr: unordered_map " << legacy_ns << " ns, side struct " << side_struct_ns
+              << " ns per lookup" << std::endl;
+  }
+
+  for (NVGcontext *ctx: contexts) {
+    nvgDeleteInternal(ctx);
+  }
+}
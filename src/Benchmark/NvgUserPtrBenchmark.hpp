@@ -0,0 +1,10 @@
+#pragma once
+
+class BenchmarkReport;
+
+// Compares the old Emulator.h user pointer lookup (unordered_map keyed by context) against the side struct read that
+// getUserPtr does now. Needs a current GL context, the contexts it creates are real.
+class NvgUserPtrBenchmark {
+  public:
+  static void Run(BenchmarkReport &report);
+};
@@ -0,0 +1,366 @@
+#include "ReloadSoak.hpp"
+
+#include "Application/Application.hpp"
+#include "BenchmarkReport.hpp"
+#include "FileDialog/FileDialog.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "Profiling/HeapTracker.hpp"
+//
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string_view>
+#include <unistd.h>
+
+static constexpr int DEFAULT_CYCLES = 100;
+// Font and image caches, shader compiles, the update pool and lazily loaded libraries settle in the first cycles
+static constexpr int WARMUP_CYCLES = 2;
+static constexpr float FRAME_TIME = 1.0f / 60.0f;
+static constexpr GLuint GL_PROBE_LIMIT = 4096;  // drivers hand out the lowest free names first
+static constexpr double RSS_LEAK_BYTES = 64.0 * 1024.0;  // per cycle, less is allocator noise
+static constexpr double COUNT_LEAK = 0.5;  // per cycle, one more fd, thread or GL object every other reload
+static constexpr int LISTED_CULPRITS = 3;
+
+std::expected<std::optional<ReloadSoak::Options>, std::string> ReloadSoak::ParseArgs(const int argc, char **argv) {
+  std::optional<Options> options;
+  int cycles = DEFAULT_CYCLES;
+  std::string report_path = "soak_report.json";
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (arg != "--soak" && arg != "--cycles" && arg != "--report") {
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return std::unexpected(std::string(arg) + " needs a value");
+    }
+    const std::string_view value = argv[++i];
+    if (arg == "--soak") {
+      options = Options{std::string(value), 0, ""};
+    } else if (arg == "--cycles") {
+      const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), cycles);
+      if (error != std::errc() || end != value.data() + value.size() || cycles < 1) {
+        return std::unexpected("--cycles expects a positive number, got " + std::string(value));
+      }
+    } else {
+      report_path = value;
+    }
+  }
+  if (options.has_value()) {
+    options->cycles = cycles;
+    options->report_path = report_path;
+  }
+  return options;
+}
+
+const std::array<const char *, ReloadSoak::GL_KINDS> &ReloadSoak::GlKindNames() {
+  static constexpr std::array<const char *, GL_KINDS> names = {
+      "textures", "buffers", "framebuffers", "renderbuffers", "vertex arrays", "programs", "shaders"};
+  return names;
+}
+
+int ReloadSoak::Resources::GlTotal() const { return std::accumulate(gl_objects.begin(), gl_objects.end(), 0); }
+
+static uint64_t read_rss() {
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+// One entry per open fd (its link target) or per thread (its name), so two samples can be diffed for the culprit
+static std::vector<std::string> list_fds() {
+  std::vector<std::string> targets;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it("/proc/self/fd", error), end; !error && it != end; it.increment(error)) {
+    std::error_code link_error;
+    const auto target = std::filesystem::read_symlink(it->path(), link_error);
+    // The directory's own fd is listed too, a constant that doesn't show up as growth
+    if (!link_error) {
+      targets.push_back(target.string());
+    }
+  }
+  return targets;
+}
+
+static std::vector<std::string> list_threads() {
+  std::vector<std::string> names;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it("/proc/self/task", error), end; !error && it != end;
+       it.increment(error)) {
+    std::ifstream comm(it->path() / "comm");
+    std::string name;
+    if (std::getline(comm, name)) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+static std::array<int, ReloadSoak::GL_KINDS> count_gl_objects() {
+  // GL can't enumerate its objects, probe the low names instead. Names generated but never bound aren't objects yet.
+  static constexpr std::array<GLboolean (*)(GLuint), ReloadSoak::GL_KINDS> probes = {
+      [](const GLuint name) { return glIsTexture(name); },
+      [](const GLuint name) { return glIsBuffer(name); },
+      [](const GLuint name) { return glIsFramebuffer(name); },
+      [](const GLuint name) { return glIsRenderbuffer(name); },
+      [](const GLuint name) { return glIsVertexArray(name); },
+      [](const GLuint name) { return glIsProgram(name); },
+      [](const GLuint name) { return glIsShader(name); },
+  };
+  std::array<int, ReloadSoak::GL_KINDS> counts{};
+  for (int kind = 0; kind < ReloadSoak::GL_KINDS; kind++) {
+    for (GLuint name = 1; name <= GL_PROBE_LIMIT; name++) {
+      counts[kind] += probes[kind](name) == GL_TRUE;
+    }
+  }
+  return counts;
+}
+
+ReloadSoak::Resources ReloadSoak::Sample() {
+  return Resources{read_rss(), static_cast<int>(list_fds().size()), static_cast<int>(list_threads().size()),
+                   count_gl_objects()};
+}
+
+// Least squares growth per cycle
+static double slope(const std::vector<double> &values) {
+  const auto n = static_cast<double>(values.size());
+  if (values.size() < 2) {
+    return 0.0;
+  }
+  const double mean_x = (n - 1.0) / 2.0;
+  const double mean_y = std::accumulate(values.begin(), values.end(), 0.0) / n;
+  double covariance = 0.0, variance = 0.0;
+  for (size_t i = 0; i < values.size(); i++) {
+    const double dx = static_cast<double>(i) - mean_x;
+    covariance += dx * (values[i] - mean_y);
+    variance += dx * dx;
+  }
+  return covariance / variance;
+}
+
+static double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  const auto middle = values.begin() + static_cast<long>(values.size() / 2);
+  std::nth_element(values.begin(), middle, values.end());
+  return *middle;
+}
+
+// Entries of after that weren't in before, most frequent first: "12x /tmp/gauge-shadow/Foo.so (deleted)"
+static std::string new_entries(const std::vector<std::string> &before, const std::vector<std::string> &after) {
+  std::map<std::string, int> counts;
+  for (const auto &entry: after) counts[entry]++;
+  for (const auto &entry: before) counts[entry]--;
+  std::vector<std::pair<int, std::string>> grown;
+  for (const auto &[entry, count]: counts) {
+    if (count > 0) grown.emplace_back(count, entry);
+  }
+  std::ranges::sort(grown, std::greater{});
+  std::string list;
+  for (int i = 0; i < std::min<int>(LISTED_CULPRITS, static_cast<int>(grown.size())); i++) {
+    list += (list.empty() ? "" : ", ") + std::to_string(grown[i].first) + "x " + grown[i].second;
+  }
+  return list;
+}
+
+std::expected<ReloadSoak::Summary, std::string> ReloadSoak::Run(const Options &options, BenchmarkReport &report) {
+  auto loader = GaugeLoader::GetInstance();
+  if (loader->AreGaugesLoaded()) {
+    return std::unexpected(std::string("Soak needs an emulator without gauges loaded"));
+  }
+  const std::string gauge_name = FileDialog::GetFileName(options.gauge_path);
+  loader->SetWatchFiles(false);
+
+  struct Cycle {
+    GaugeLoader::ReloadStats stats;  // unload of the previous cycle's gauge, then this cycle's load
+    double first_frame;
+    Resources resources;
+  };
+  std::vector<Cycle> cycles;
+  cycles.reserve(options.cycles);
+  std::vector<GaugeLoader::ReloadStats> unloads;
+  bool arena = false;
+  std::vector<std::string> baseline_fds, baseline_threads;
+
+  std::cout << "[Soak] Reloading " << gauge_name << " " << options.cycles << " times" << std::endl;
+  for (int i = 0; i < options.cycles; i++) {
+    // Hidden windows still have to answer the compositor
+    glfwPollEvents();
+    if (loader->AreGaugesLoaded()) {
+      if (auto result = loader->UnloadAllGauges(); !result.has_value()) {
+        return std::unexpected(result.error());
+      }
+      unloads.push_back(loader->GetReloadStats());
+    }
+    GaugeHandle handle;
+    try {
+      handle = loader->GetOrLoadGauge(options.gauge_path, gauge_name);
+    } catch (const std::exception &e) {
+      return std::unexpected("Cycle " + std::to_string(i + 1) + ": " + e.what());
+    }
+
+    Cycle cycle{loader->GetReloadStats(), 0.0, {}};
+    if (i == 0) {
+      cycle.stats.save_state = cycle.stats.kill = cycle.stats.close = 0.0;
+      const GaugeDispatch *dispatch = loader->GetDispatch(handle);
+      for (const auto &row: HeapTracker::GetInstance()->GetRows()) {
+        arena |= dispatch && row.ctx == dispatch->ctx && row.arena;
+      }
+    }
+
+    const auto frame_start = std::chrono::steady_clock::now();
+    loader->UpdateGauges(FRAME_TIME);
+    for (auto &renderer: loader->GetAllRenderers()) {
+      renderer.RenderOffscreen(true);
+    }
+    // Draw calls only queue work, the frame is done once the GPU is
+    glFinish();
+    const auto frame_end = std::chrono::steady_clock::now();
+    cycle.first_frame = std::chrono::duration<double, std::milli>(frame_end - frame_start).count();
+    HeapTracker::GetInstance()->EndFrame();
+
+    cycle.resources = Sample();
+    if (i == WARMUP_CYCLES) {
+      baseline_fds = list_fds();
+      baseline_threads = list_threads();
+    }
+    const auto &stats = cycle.stats;
+    const double load_ms = stats.copy + stats.parse + stats.check_imports + stats.open + stats.resolve;
+    std::cout << "[Soak] " << i + 1 << "/" << options.cycles << ": unload " << stats.kill + stats.close << " ms, load "
+              << load_ms << " ms, init " << stats.init << " ms, first frame " << cycle.first_frame << " ms, rss "
+              << cycle.resources.rss_bytes / (1024 * 1024) << " MiB, " << cycle.resources.fds << " fds, "
+              << cycle.resources.threads << " threads, " << cycle.resources.GlTotal() << " GL objects" << std::endl;
+    cycles.push_back(cycle);
+  }
+  if (auto result = loader->UnloadAllGauges(); !result.has_value()) {
+    return std::unexpected(result.error());
+  }
+  unloads.push_back(loader->GetReloadStats());
+
+  // The first load is cold (page cache, dynamic linker caches), later ones are what a developer waits for
+  struct Phase {
+    const char *name;
+    double GaugeLoader::ReloadStats::*field;
+    bool unload;
+  };
+  static constexpr Phase phases[] = {
+      {"kill", &GaugeLoader::ReloadStats::kill, true},
+      {"dlclose", &GaugeLoader::ReloadStats::close, true},
+      {"copy", &GaugeLoader::ReloadStats::copy, false},
+      {"json_parse", &GaugeLoader::ReloadStats::parse, false},
+      {"check_imports", &GaugeLoader::ReloadStats::check_imports, false},
+      {"dlopen", &GaugeLoader::ReloadStats::open, false},
+      {"symbol_resolve", &GaugeLoader::ReloadStats::resolve, false},
+      {"init", &GaugeLoader::ReloadStats::init, false},
+  };
+  const auto add_phase = [&](const std::string &name, const std::optional<double> cold, std::vector<double> warm) {
+    if (cold.has_value()) {
+      report.Add("soak." + name + ".cold", cold.value(), "ms");
+    }
+    if (!warm.empty()) {
+      report.Add("soak." + name + ".max", *std::ranges::max_element(warm), "ms");
+      report.Add("soak." + name + ".p50", median(std::move(warm)), "ms");
+    }
+  };
+  for (const Phase &phase: phases) {
+    std::vector<double> warm;
+    if (phase.unload) {
+      for (const auto &unload: unloads) warm.push_back(unload.*phase.field);
+    } else {
+      for (size_t i = 1; i < cycles.size(); i++) warm.push_back(cycles[i].stats.*phase.field);
+    }
+    const auto cold = phase.unload ? std::nullopt : std::optional(cycles.front().stats.*phase.field);
+    add_phase(phase.name, cold, std::move(warm));
+  }
+  std::vector<double> frames;
+  for (size_t i = 1; i < cycles.size(); i++) frames.push_back(cycles[i].first_frame);
+  add_phase("first_frame", cycles.front().first_frame, std::move(frames));
+  report.Add("soak.cycles", static_cast<double>(cycles.size()), "cycles");
+
+  Summary summary{static_cast<int>(cycles.size()), {}};
+  if (cycles.size() < WARMUP_CYCLES + 3) {
+    std::cout << "[Soak] Too few cycles after warm up to judge growth, run at least " << WARMUP_CYCLES + 3 << std::endl;
+  } else {
+    std::vector<double> rss, fds, threads, heap_bytes, heap_blocks;
+    std::array<std::vector<double>, GL_KINDS> gl;
+    for (size_t i = WARMUP_CYCLES; i < cycles.size(); i++) {
+      const Resources &resources = cycles[i].resources;
+      rss.push_back(static_cast<double>(resources.rss_bytes));
+      fds.push_back(resources.fds);
+      threads.push_back(resources.threads);
+      for (int kind = 0; kind < GL_KINDS; kind++) gl[kind].push_back(resources.gl_objects[kind]);
+    }
+    // unloads[i] closed cycle i's gauge. What it left in an arena went away with the arena, only blocks left on the
+    // process heap pile up from one reload to the next.
+    double arena_bytes = 0.0;
+    for (size_t i = WARMUP_CYCLES; i < unloads.size(); i++) {
+      const double bytes = static_cast<double>(unloads[i].leaked_bytes);
+      const double blocks = static_cast<double>(unloads[i].leaked_blocks);
+      arena_bytes += arena ? bytes : 0.0;
+      heap_bytes.push_back((heap_bytes.empty() ? 0.0 : heap_bytes.back()) + (arena ? 0.0 : bytes));
+      heap_blocks.push_back((heap_blocks.empty() ? 0.0 : heap_blocks.back()) + (arena ? 0.0 : blocks));
+    }
+    const double heap_growth = slope(heap_bytes);
+    const double block_growth = slope(heap_blocks);
+    report.Add("soak.gauge_heap.growth", heap_growth, "bytes/cycle");
+    if (arena) {
+      report.Add("soak.gauge_heap.arena_reclaimed", arena_bytes / static_cast<double>(heap_bytes.size()),
+                 "bytes/unload");
+    }
+    if (block_growth >= COUNT_LEAK) {
+      summary.leaks.push_back(gauge_name + " leaves " + std::to_string(static_cast<int64_t>(heap_growth)) +
+                              " bytes in " + std::to_string(block_growth) + " blocks per reload on the process heap");
+    }
+
+    const double rss_growth = slope(rss);
+    const double fd_growth = slope(fds);
+    const double thread_growth = slope(threads);
+    report.Add("soak.rss.growth", rss_growth, "bytes/cycle");
+    report.Add("soak.rss.final", static_cast<double>(cycles.back().resources.rss_bytes), "bytes");
+    report.Add("soak.fds.growth", fd_growth, "fds/cycle");
+    report.Add("soak.threads.growth", thread_growth, "threads/cycle");
+
+    if (rss_growth > RSS_LEAK_BYTES) {
+      summary.leaks.push_back("RSS grows " + std::to_string(static_cast<int64_t>(rss_growth / 1024.0)) +
+                              " KiB per reload, " +
+                              (heap_growth >= rss_growth / 2.0
+                                   ? "mostly " + gauge_name + "'s unfreed heap"
+                                   : "not in " + gauge_name + "'s heap: the emulator or a library it loaded"));
+    }
+    if (fd_growth >= COUNT_LEAK) {
+      summary.leaks.push_back("fds grow " + std::to_string(fd_growth) + " per reload, new: " +
+                              new_entries(baseline_fds, list_fds()));
+    }
+    if (thread_growth >= COUNT_LEAK) {
+      summary.leaks.push_back("threads grow " + std::to_string(thread_growth) + " per reload, new: " +
+                              new_entries(baseline_threads, list_threads()));
+    }
+    double gl_growth = 0.0;
+    std::string gl_kinds;
+    for (int kind = 0; kind < GL_KINDS; kind++) {
+      const double growth = slope(gl[kind]);
+      gl_growth += growth;
+      if (growth >= COUNT_LEAK) {
+        gl_kinds += (gl_kinds.empty() ? "" : ", ") + std::to_string(growth) + " " + GlKindNames()[kind];
+      }
+    }
+    report.Add("soak.gl_objects.growth", gl_growth, "objects/cycle");
+    if (!gl_kinds.empty()) {
+      summary.leaks.push_back("GL objects grow per reload (" + gl_kinds + "), " + gauge_name +
+                              "'s kill or the emulator's NanoVG backend doesn't delete them");
+    }
+  }
+
+  for (const auto &leak: summary.leaks) {
+    std::cerr << "[Soak] Leak: " << leak << std::endl;
+  }
+  std::cout << "[Soak] Done, " << summary.cycles << " cycles, " << summary.leaks.size() << " leaks" << std::endl;
+  return summary;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <vector>
+
+class BenchmarkReport;
+
+// Headless hot reload soak: unloads and reloads one gauge over and over the way reload_gauge does, timing every phase
+// of the cycle and sampling the process after each one. Resources that keep growing once the first cycles have warmed
+// the caches are reported as leaks, attributed to the gauge when its heap accounting shows the blocks and to the
+// emulator (or a library it loaded) otherwise.
+//
+//   FS2024_WASM_Emulator --soak path/to/Gauge.so [--cycles 200] [--report soak_report.json]
+class ReloadSoak {
+  public:
+  struct Options {
+    std::string gauge_path;
+    int cycles;
+    std::string report_path;
+  };
+  // nullopt when there is no --soak on the command line
+  static std::expected<std::optional<Options>, std::string> ParseArgs(int argc, char **argv);
+
+  static constexpr int GL_KINDS = 7;
+  static const std::array<const char *, GL_KINDS> &GlKindNames();
+
+  struct Resources {
+    uint64_t rss_bytes;
+    int fds;
+    int threads;
+    std::array<int, GL_KINDS> gl_objects;  // textures, buffers, framebuffers, renderbuffers, vertex arrays, ...
+    int GlTotal() const;
+  };
+  // Needs a current GL context for the GL object count
+  static Resources Sample();
+
+  struct Summary {
+    int cycles;
+    std::vector<std::string> leaks;  // one line per resource that kept growing
+  };
+  // Main thread, with the application's GL context current and no other gauge loaded. Adds "soak.*" results.
+  static std::expected<Summary, std::string> Run(const Options &options, BenchmarkReport &report);
+};
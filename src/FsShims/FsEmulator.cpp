@@ -0,0 +1,32 @@
+#include "FsEmulator.hpp"
+
+#include "Application/Application.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "GaugeLoader/ReloadCache.hpp"
+
+extern "C" {
+void fsEmulatorRequestRedraw(FsContext ctx) {
+  GaugeLoader::GetInstance()->InvalidateGauge(ctx);
+  Application::RequestRedraw();
+}
+
+void fsEmulatorStateWrite(sEmulatorStateBuffer *buffer, const void *data, unsigned long size) {
+  if (!buffer || !data || size == 0) {
+    return;
+  }
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  buffer->data.insert(buffer->data.end(), bytes, bytes + size);
+}
+
+const void *fsEmulatorGetRestoredState(FsContext ctx, unsigned long *size) {
+  return ReloadCache::GetInstance()->GetRestoredState(ctx, size);
+}
+
+const unsigned char *fsEmulatorLoadResource(const char *path, unsigned long *size) {
+  if (!path) {
+    if (size) *size = 0;
+    return nullptr;
+  }
+  return ReloadCache::GetInstance()->LoadResource(path, size);
+}
+}
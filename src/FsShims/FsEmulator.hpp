@@ -0,0 +1,14 @@
+#pragma once
+
+#include "FsCore.hpp"
+
+struct sEmulatorStateBuffer;
+
+// Emulator only extensions, declared for gauges in include/Emulator.h. None of these exist in the sim.
+extern "C" {
+void fsEmulatorRequestRedraw(FsContext ctx);
+
+void fsEmulatorStateWrite(sEmulatorStateBuffer *buffer, const void *data, unsigned long size);
+const void *fsEmulatorGetRestoredState(FsContext ctx, unsigned long *size);
+const unsigned char *fsEmulatorLoadResource(const char *path, unsigned long *size);
+}
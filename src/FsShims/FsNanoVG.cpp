@@ -0,0 +1,113 @@
+#include "FsNanoVG.hpp"
+
+#include <GL/glew.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#define NANOVG_GL3_IMPLEMENTATION
+#include "nanovg_gl.h"
+
+// Each callback unwraps the side struct and forwards to the GL3 backend, nanovg only ever sees the side struct
+static GLNVGcontext *gl_backend(void *uptr) {
+  return static_cast<GLNVGcontext *>(static_cast<EmulatorNVGBackend *>(uptr)->backend);
+}
+
+static int emulator_render_create(void *uptr) { return glnvg__renderCreate(gl_backend(uptr)); }
+
+static int emulator_render_create_texture(void *uptr, int type, int w, int h, int imageFlags,
+                                          const unsigned char *data) {
+  return glnvg__renderCreateTexture(gl_backend(uptr), type, w, h, imageFlags, data);
+}
+
+static int emulator_render_delete_texture(void *uptr, int image) {
+  return glnvg__renderDeleteTexture(gl_backend(uptr), image);
+}
+
+static int emulator_render_update_texture(void *uptr, int image, int x, int y, int w, int h,
+                                          const unsigned char *data) {
+  return glnvg__renderUpdateTexture(gl_backend(uptr), image, x, y, w, h, data);
+}
+
+static int emulator_render_get_texture_size(void *uptr, int image, int *w, int *h) {
+  return glnvg__renderGetTextureSize(gl_backend(uptr), image, w, h);
+}
+
+static void emulator_render_viewport(void *uptr, float width, float height, float devicePixelRatio) {
+  glnvg__renderViewport(gl_backend(uptr), width, height, devicePixelRatio);
+}
+
+static void emulator_render_cancel(void *uptr) { glnvg__renderCancel(gl_backend(uptr)); }
+
+static void emulator_render_flush(void *uptr) { glnvg__renderFlush(gl_backend(uptr)); }
+
+static void emulator_render_fill(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                                 NVGscissor *scissor, float fringe, const float *bounds, const NVGpath *paths,
+                                 int npaths) {
+  glnvg__renderFill(gl_backend(uptr), paint, compositeOperation, scissor, fringe, bounds, paths, npaths);
+}
+
+static void emulator_render_stroke(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                                   NVGscissor *scissor, float fringe, float strokeWidth, const NVGpath *paths,
+                                   int npaths) {
+  glnvg__renderStroke(gl_backend(uptr), paint, compositeOperation, scissor, fringe, strokeWidth, paths, npaths);
+}
+
+static void emulator_render_triangles(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                                      NVGscissor *scissor, const NVGvertex *verts, int nverts, float fringe) {
+  glnvg__renderTriangles(gl_backend(uptr), paint, compositeOperation, scissor, verts, nverts, fringe);
+}
+
+// Set when nanovg tore the backend down itself, see fsEmulatorCreateNVGContext
+static thread_local bool s_RenderDeleted = false;
+
+static void emulator_render_delete(void *uptr) {
+  s_RenderDeleted = true;
+  auto *side = static_cast<EmulatorNVGBackend *>(uptr);
+  glnvg__renderDelete(side->backend);
+  delete side;
+}
+
+extern "C" {
+// Same setup as nvgCreateGL3, with the side struct in front of the backend
+NVGcontext *fsEmulatorCreateNVGContext(NVGparams *params) {
+  auto *gl = static_cast<GLNVGcontext *>(std::malloc(sizeof(GLNVGcontext)));
+  if (!gl) {
+    return nullptr;
+  }
+  std::memset(gl, 0, sizeof(GLNVGcontext));
+  gl->flags = NVG_STENCIL_STROKES | (!params || params->edgeAntiAlias ? NVG_ANTIALIAS : 0);
+
+  auto *side = new (std::nothrow) EmulatorNVGBackend{params ? params->userPtr : nullptr, gl};
+  if (!side) {
+    std::free(gl);
+    return nullptr;
+  }
+
+  NVGparams backend_params;
+  std::memset(&backend_params, 0, sizeof(backend_params));
+  backend_params.renderCreate = emulator_render_create;
+  backend_params.renderCreateTexture = emulator_render_create_texture;
+  backend_params.renderDeleteTexture = emulator_render_delete_texture;
+  backend_params.renderUpdateTexture = emulator_render_update_texture;
+  backend_params.renderGetTextureSize = emulator_render_get_texture_size;
+  backend_params.renderViewport = emulator_render_viewport;
+  backend_params.renderCancel = emulator_render_cancel;
+  backend_params.renderFlush = emulator_render_flush;
+  backend_params.renderFill = emulator_render_fill;
+  backend_params.renderStroke = emulator_render_stroke;
+  backend_params.renderTriangles = emulator_render_triangles;
+  backend_params.renderDelete = emulator_render_delete;
+  backend_params.userPtr = side;
+  backend_params.edgeAntiAlias = (gl->flags & NVG_ANTIALIAS) ? 1 : 0;
+
+  // If backend setup fails nvgCreateInternal runs renderDelete, which frees gl and side. It doesn't when allocating the
+  // context itself fails, the params were never copied, and nothing but the two allocations exists yet.
+  s_RenderDeleted = false;
+  NVGcontext *context = nvgCreateInternal(&backend_params);
+  if (!context && !s_RenderDeleted) {
+    std::free(gl);
+    delete side;
+  }
+  return context;
+}
+}
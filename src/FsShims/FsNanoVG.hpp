@@ -0,0 +1,15 @@
+#pragma once
+
+#include "nanovg.h"
+
+// The gauge facing NanoVG context. It runs on the GL3 backend, but nvgInternalParams(ctx)->userPtr points at this
+// struct so the pointer the gauge passed in is one load away (see getUserPtr in include/Emulator.h). user_ptr must stay
+// the first member, gauges rely on that layout.
+struct EmulatorNVGBackend {
+  void *user_ptr;
+  void *backend;  // GLNVGcontext
+};
+
+extern "C" {
+NVGcontext *fsEmulatorCreateNVGContext(NVGparams *params);
+}
@@ -4,6 +4,7 @@
 #include <map>
 
 #include "GaugeLoader/GaugeLoader.hpp"
+#include "Profiling/SimVarProfiler.hpp"
 
 
 static std::map<std::string, double> s_Vars;
@@ -23,12 +24,15 @@ FsVarError fsVarsAircraftVarGet(FsSimVarId simvar, FsUnitId unit, FsVarParamArra
   if (result == nullptr) {
     return FS_VAR_ERROR_INVALID_ARGS;
   }
+  CallbackScope::RecordRead(simvar);
+  SimVarProfiler::Record(simvar, unit, SimVarProfiler::Access::Read);
   auto gauge_loader = GaugeLoader::GetInstance();
   auto value = gauge_loader->GetVariable(simvar);
   result[0] = value;
   return 0;
 }
 FsVarError fsVarsAircraftVarSet(FsSimVarId simvar, FsUnitId unit, FsVarParamArray param, double value) {
+  SimVarProfiler::Record(simvar, unit, SimVarProfiler::Access::Write);
   auto gauge_loader = GaugeLoader::GetInstance();
   gauge_loader->UpdateVariable(simvar, value);
   return 0;
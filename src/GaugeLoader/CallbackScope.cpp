@@ -0,0 +1,46 @@
+#include "CallbackScope.hpp"
+
+thread_local CallbackScope *CallbackScope::s_Current = nullptr;
+
+void GaugeReadSet::Record(const int id, const bool in_draw) {
+  if (id < 0) {
+    return;
+  }
+  if (static_cast<size_t>(id) >= tracked.size()) {
+    tracked.resize(id + 1, false);
+  }
+  if (tracked[id]) {
+    return;
+  }
+  tracked[id] = true;
+  // The version is filled in by MarkDrawn. A dependency first seen outside draw (in update or the mouse handler) may
+  // already have changed since the last draw, so that draw can't be trusted anymore.
+  variables.emplace_back(id, 0);
+  if (!in_draw) {
+    stale = true;
+  }
+}
+
+bool GaugeReadSet::NeedsDraw(const std::vector<uint64_t> &versions, const uint64_t epoch) const {
+  if (stale) {
+    return true;
+  }
+  // Nothing at all was written since the last draw, the common case for a static page
+  if (epoch == drawn_epoch) {
+    return false;
+  }
+  for (const auto &[id, version]: variables) {
+    if (static_cast<size_t>(id) < versions.size() && versions[id] != version) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void GaugeReadSet::MarkDrawn(const std::vector<uint64_t> &versions, const uint64_t epoch) {
+  for (auto &[id, version]: variables) {
+    version = static_cast<size_t>(id) < versions.size() ? versions[id] : 0;
+  }
+  drawn_epoch = epoch;
+  stale = false;
+}
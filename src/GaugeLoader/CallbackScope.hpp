@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Simvars one gauge depends on, collected while its callbacks run. The set only grows until the gauge is reloaded,
+// a variable that is no longer read costs at most a redundant redraw.
+struct GaugeReadSet {
+  std::vector<std::pair<int, uint64_t>> variables;  // <id, version the last draw saw>
+  std::vector<bool> tracked;  // indexed by id, dedupes variables
+  uint64_t drawn_epoch = 0;  // variable epoch at the end of the last draw
+  bool stale = true;  // the last draw is out of date for a reason versions can't show (first frame, redraw request)
+
+  void Record(int id, bool in_draw);
+  // versions and epoch are the simvar layer's current counters, see GaugeLoader::GetVariableVersions
+  bool NeedsDraw(const std::vector<uint64_t> &versions, uint64_t epoch) const;
+  void MarkDrawn(const std::vector<uint64_t> &versions, uint64_t epoch);
+};
+
+// Attributes simvar access on this thread to a gauge for as long as one of its callbacks runs. Parallel updates each
+// get their own scope on their worker, so recording needs no locking. reads may be null (init).
+class CallbackScope {
+  public:
+  CallbackScope(const unsigned long long ctx, GaugeReadSet *reads, const bool in_draw)
+      : m_Ctx(ctx)
+      , m_Reads(reads)
+      , m_InDraw(in_draw)
+      , m_Previous(s_Current) {
+    s_Current = this;
+  }
+  ~CallbackScope() { s_Current = m_Previous; }
+
+  CallbackScope(const CallbackScope &) = delete;
+  CallbackScope &operator=(const CallbackScope &) = delete;
+
+  static void RecordRead(const int id) {
+    if (s_Current && s_Current->m_Reads) {
+      s_Current->m_Reads->Record(id, s_Current->m_InDraw);
+    }
+  }
+
+  // ctx of the gauge whose callback is running on this thread, 0 outside of gauge code
+  static unsigned long long GetCurrentContext() { return s_Current ? s_Current->m_Ctx : 0; }
+
+  private:
+  unsigned long long m_Ctx;
+  GaugeReadSet *m_Reads;
+  bool m_InDraw;
+  CallbackScope *m_Previous;
+
+  static thread_local CallbackScope *s_Current;
+};
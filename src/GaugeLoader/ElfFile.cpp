@@ -0,0 +1,240 @@
+#include "ElfFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+
+std::expected<ElfFile, std::string> ElfFile::Load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return std::unexpected("Failed to open " + path);
+  }
+  const auto size = static_cast<size_t>(file.tellg());
+  file.seekg(0);
+
+  ElfFile elf;
+  elf.m_Data.resize(size);
+  if (!file.read(reinterpret_cast<char *>(elf.m_Data.data()), static_cast<std::streamsize>(size))) {
+    return std::unexpected("Failed to read " + path);
+  }
+
+  if (auto result = elf.Validate(); !result.has_value()) {
+    return std::unexpected(result.error());
+  }
+  return elf;
+}
+
+uint64_t ElfFile::GetHash() const {
+  // FNV-1a, only used to give every distinct build its own file name
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const unsigned char byte: m_Data) {
+    hash ^= byte;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::expected<void, std::string> ElfFile::Validate() const {
+  const size_t size = m_Data.size();
+  if (size < sizeof(Elf64_Ehdr)) {
+    return std::unexpected("file is truncated (no ELF header)");
+  }
+
+  Elf64_Ehdr header;
+  std::memcpy(&header, m_Data.data(), sizeof(header));
+  if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) {
+    return std::unexpected("not an ELF file");
+  }
+  if (header.e_ident[EI_CLASS] != ELFCLASS64 || header.e_ident[EI_DATA] != ELFDATA2LSB) {
+    return std::unexpected("not a little endian 64 bit ELF file");
+  }
+  if (header.e_type != ET_DYN) {
+    return std::unexpected("not a shared library");
+  }
+#if defined(__x86_64__)
+  if (header.e_machine != EM_X86_64) {
+    return std::unexpected("built for a different architecture");
+  }
+#elif defined(__aarch64__)
+  if (header.e_machine != EM_AARCH64) {
+    return std::unexpected("built for a different architecture");
+  }
+#endif
+
+  // Linkers write the section header table last, so a half-written file fails here first
+  if (header.e_shoff == 0 || header.e_shentsize != sizeof(Elf64_Shdr) ||
+      header.e_shoff + static_cast<uint64_t>(header.e_shnum) * sizeof(Elf64_Shdr) > size) {
+    return std::unexpected("file is truncated (section headers out of range)");
+  }
+  if (header.e_phentsize != sizeof(Elf64_Phdr) ||
+      header.e_phoff + static_cast<uint64_t>(header.e_phnum) * sizeof(Elf64_Phdr) > size) {
+    return std::unexpected("file is truncated (program headers out of range)");
+  }
+
+  bool has_dynamic = false;
+  for (int i = 0; i < header.e_phnum; i++) {
+    Elf64_Phdr program;
+    std::memcpy(&program, m_Data.data() + header.e_phoff + i * sizeof(Elf64_Phdr), sizeof(program));
+    if (program.p_type == PT_DYNAMIC) {
+      has_dynamic = true;
+    }
+    if ((program.p_type == PT_LOAD || program.p_type == PT_DYNAMIC) && program.p_offset + program.p_filesz > size) {
+      return std::unexpected("file is truncated (segment out of range)");
+    }
+  }
+  if (!has_dynamic) {
+    return std::unexpected("no dynamic segment");
+  }
+
+  for (int i = 0; i < header.e_shnum; i++) {
+    Elf64_Shdr section;
+    std::memcpy(&section, m_Data.data() + header.e_shoff + i * sizeof(Elf64_Shdr), sizeof(section));
+    if (section.sh_type != SHT_NOBITS && section.sh_offset + section.sh_size > size) {
+      return std::unexpected("file is truncated (section out of range)");
+    }
+  }
+
+  return {};
+}
+
+std::vector<ElfFile::Import> ElfFile::GetImports() const {
+  std::vector<Import> imports;
+
+  // Validate() already bounds checked the header and every section
+  Elf64_Ehdr header;
+  std::memcpy(&header, m_Data.data(), sizeof(header));
+  const auto read_section = [this, &header](const int index) {
+    Elf64_Shdr section;
+    std::memcpy(&section, m_Data.data() + header.e_shoff + index * sizeof(Elf64_Shdr), sizeof(section));
+    return section;
+  };
+
+  for (int i = 0; i < header.e_shnum; i++) {
+    const Elf64_Shdr symbols = read_section(i);
+    if (symbols.sh_type != SHT_DYNSYM || symbols.sh_entsize != sizeof(Elf64_Sym) || symbols.sh_link >= header.e_shnum) {
+      continue;
+    }
+    const Elf64_Shdr strings = read_section(static_cast<int>(symbols.sh_link));
+    const auto *string_table = reinterpret_cast<const char *>(m_Data.data() + strings.sh_offset);
+
+    const size_t count = symbols.sh_size / sizeof(Elf64_Sym);
+    for (size_t j = 1; j < count; j++) {
+      Elf64_Sym symbol;
+      std::memcpy(&symbol, m_Data.data() + symbols.sh_offset + j * sizeof(Elf64_Sym), sizeof(symbol));
+      const unsigned char binding = ELF64_ST_BIND(symbol.st_info);
+      if (symbol.st_shndx != SHN_UNDEF || binding == STB_LOCAL || symbol.st_name >= strings.sh_size) {
+        continue;
+      }
+      const char *name = string_table + symbol.st_name;
+      const size_t length = strnlen(name, strings.sh_size - symbol.st_name);
+      if (length == 0) {
+        continue;
+      }
+      imports.push_back(Import{std::string(name, length), binding == STB_WEAK});
+    }
+  }
+  return imports;
+}
+
+std::vector<ElfFile::Relocation> ElfFile::GetSymbolRelocations() const {
+  std::vector<Relocation> relocations;
+
+  Elf64_Ehdr header;
+  std::memcpy(&header, m_Data.data(), sizeof(header));
+  const auto read_section = [this, &header](const int index) {
+    Elf64_Shdr section;
+    std::memcpy(&section, m_Data.data() + header.e_shoff + index * sizeof(Elf64_Shdr), sizeof(section));
+    return section;
+  };
+
+  for (int i = 0; i < header.e_shnum; i++) {
+    const Elf64_Shdr rela = read_section(i);
+    if (rela.sh_type != SHT_RELA || rela.sh_entsize != sizeof(Elf64_Rela) || rela.sh_link >= header.e_shnum) {
+      continue;
+    }
+    const Elf64_Shdr symbols = read_section(static_cast<int>(rela.sh_link));
+    if (symbols.sh_type != SHT_DYNSYM || symbols.sh_link >= header.e_shnum) {
+      continue;
+    }
+    const Elf64_Shdr strings = read_section(static_cast<int>(symbols.sh_link));
+    const auto *string_table = reinterpret_cast<const char *>(m_Data.data() + strings.sh_offset);
+    const size_t symbol_count = symbols.sh_size / sizeof(Elf64_Sym);
+
+    const size_t count = rela.sh_size / sizeof(Elf64_Rela);
+    for (size_t j = 0; j < count; j++) {
+      Elf64_Rela entry;
+      std::memcpy(&entry, m_Data.data() + rela.sh_offset + j * sizeof(Elf64_Rela), sizeof(entry));
+      const uint32_t symbol_index = ELF64_R_SYM(entry.r_info);
+      if (symbol_index == 0 || symbol_index >= symbol_count) {
+        continue;
+      }
+      Elf64_Sym symbol;
+      std::memcpy(&symbol, m_Data.data() + symbols.sh_offset + symbol_index * sizeof(Elf64_Sym), sizeof(symbol));
+      if (symbol.st_name == 0 || symbol.st_name >= strings.sh_size) {
+        continue;
+      }
+      const char *name = string_table + symbol.st_name;
+      relocations.push_back(Relocation{entry.r_offset, static_cast<uint32_t>(ELF64_R_TYPE(entry.r_info)), entry.r_addend,
+                                       std::string(name, strnlen(name, strings.sh_size - symbol.st_name))});
+    }
+  }
+  return relocations;
+}
+
+std::pair<uint64_t, uint64_t> ElfFile::GetRelroRange() const {
+  Elf64_Ehdr header;
+  std::memcpy(&header, m_Data.data(), sizeof(header));
+  for (int i = 0; i < header.e_phnum; i++) {
+    Elf64_Phdr program;
+    std::memcpy(&program, m_Data.data() + header.e_phoff + i * sizeof(Elf64_Phdr), sizeof(program));
+    if (program.p_type == PT_GNU_RELRO) {
+      return {program.p_vaddr, program.p_memsz};
+    }
+  }
+  return {0, 0};
+}
+
+std::vector<ElfFile::FunctionSymbol> ElfFile::GetFunctionSymbols() const {
+  std::vector<FunctionSymbol> functions;
+
+  Elf64_Ehdr header;
+  std::memcpy(&header, m_Data.data(), sizeof(header));
+  const auto read_section = [this, &header](const int index) {
+    Elf64_Shdr section;
+    std::memcpy(&section, m_Data.data() + header.e_shoff + index * sizeof(Elf64_Shdr), sizeof(section));
+    return section;
+  };
+
+  for (const uint32_t table_type: {SHT_SYMTAB, SHT_DYNSYM}) {
+    for (int i = 0; i < header.e_shnum; i++) {
+      const Elf64_Shdr symbols = read_section(i);
+      if (symbols.sh_type != table_type || symbols.sh_entsize != sizeof(Elf64_Sym) ||
+          symbols.sh_link >= header.e_shnum) {
+        continue;
+      }
+      const Elf64_Shdr strings = read_section(static_cast<int>(symbols.sh_link));
+      const auto *string_table = reinterpret_cast<const char *>(m_Data.data() + strings.sh_offset);
+
+      const size_t count = symbols.sh_size / sizeof(Elf64_Sym);
+      for (size_t j = 1; j < count; j++) {
+        Elf64_Sym symbol;
+        std::memcpy(&symbol, m_Data.data() + symbols.sh_offset + j * sizeof(Elf64_Sym), sizeof(symbol));
+        if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC || symbol.st_shndx == SHN_UNDEF || symbol.st_value == 0 ||
+            symbol.st_name == 0 || symbol.st_name >= strings.sh_size) {
+          continue;
+        }
+        const char *name = string_table + symbol.st_name;
+        functions.push_back(FunctionSymbol{symbol.st_value, symbol.st_size,
+                                           std::string(name, strnlen(name, strings.sh_size - symbol.st_name))});
+      }
+    }
+    // .symtab is a superset of .dynsym, only fall back when the file was stripped
+    if (!functions.empty()) {
+      break;
+    }
+  }
+
+  std::ranges::sort(functions, [](const FunctionSymbol &a, const FunctionSymbol &b) { return a.address < b.address; });
+  return functions;
+}
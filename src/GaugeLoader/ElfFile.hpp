@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read-only view of a gauge shared library on disk. Load() rejects truncated or foreign files before they ever reach
+// dlopen, which is what catches a .so the compiler is still writing.
+class ElfFile {
+  public:
+  static std::expected<ElfFile, std::string> Load(const std::string &path);
+
+  struct Import {
+    std::string name;
+    bool weak;  // a missing weak import resolves to null instead of failing
+  };
+
+  const std::vector<unsigned char> &GetData() const { return m_Data; }
+  uint64_t GetHash() const;
+  struct Relocation {
+    uint64_t offset;  // relative to the load address
+    uint32_t type;
+    int64_t addend;
+    std::string symbol;
+  };
+
+  // Undefined symbols in .dynsym, i.e. everything the dynamic loader has to find outside this library
+  std::vector<Import> GetImports() const;
+  // Every RELA entry that references a named dynamic symbol (.rela.dyn and .rela.plt)
+  std::vector<Relocation> GetSymbolRelocations() const;
+  // PT_GNU_RELRO as {offset, size} relative to the load address, these pages are read-only once loaded
+  std::pair<uint64_t, uint64_t> GetRelroRange() const;
+
+  struct FunctionSymbol {
+    uint64_t address;  // relative to the load address
+    uint64_t size;
+    std::string name;
+  };
+  // Defined functions from .symtab (static ones included), or .dynsym for stripped files, sorted by address
+  std::vector<FunctionSymbol> GetFunctionSymbols() const;
+
+  private:
+  ElfFile() = default;
+
+  std::expected<void, std::string> Validate() const;
+
+  std::vector<unsigned char> m_Data;
+};
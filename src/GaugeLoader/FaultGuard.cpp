@@ -0,0 +1,204 @@
+#include "FaultGuard.hpp"
+
+#include "Watchdog.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <execinfo.h>
+#include <iostream>
+#include <mutex>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <utility>
+
+thread_local FaultGuard::Frame *FaultGuard::s_Current = nullptr;
+
+static constexpr int GUARDED_SIGNALS[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+static constexpr size_t ALT_STACK_SIZE = 64 * 1024;  // backtrace() and the unwinder need more than SIGSTKSZ
+
+static struct sigaction s_Previous[NSIG];
+static bool s_Installed = false;
+static std::mutex s_FaultsMutex;
+static std::vector<FaultGuard::Fault> s_Faults;
+
+// Every thread that runs gauge code gets its own, stack overflows can't be handled on the overflowing stack
+struct AltStack {
+  void *stack = nullptr;
+
+  ~AltStack() {
+    if (stack) {
+      stack_t disable{};
+      disable.ss_flags = SS_DISABLE;
+      sigaltstack(&disable, nullptr);
+      munmap(stack, ALT_STACK_SIZE);
+    }
+  }
+
+  void Ensure() {
+    if (stack) {
+      return;
+    }
+    void *memory = mmap(nullptr, ALT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      return;
+    }
+    stack_t alt{};
+    alt.ss_sp = memory;
+    alt.ss_size = ALT_STACK_SIZE;
+    if (sigaltstack(&alt, nullptr) != 0) {
+      munmap(memory, ALT_STACK_SIZE);
+      return;
+    }
+    stack = memory;
+  }
+};
+static thread_local AltStack t_AltStack;
+
+static void *faulting_pc(void *ucontext) {
+#if defined(__x86_64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.pc);
+#else
+  return nullptr;
+#endif
+}
+
+const char *FaultGuard::CallbackName(const Callback callback) {
+  switch (callback) {
+    case Callback::Init:
+      return "init";
+    case Callback::Update:
+      return "update";
+    case Callback::Draw:
+      return "draw";
+    case Callback::Mouse:
+      return "mouse_handler";
+    case Callback::SaveState:
+      return "save_state";
+    case Callback::Kill:
+      return "kill";
+  }
+  return "";
+}
+
+std::string FaultGuard::Describe(const int signal, const int code) {
+  if (signal == HANG) {
+    return "hang (abandoned after " + std::to_string(code) + " ms)";
+  }
+  std::string name = sigabbrev_np(signal) ? std::string("SIG") + sigabbrev_np(signal) : std::to_string(signal);
+  const char *reason = nullptr;
+  if (signal == SIGSEGV) {
+    reason = code == SEGV_MAPERR ? "address not mapped" : code == SEGV_ACCERR ? "invalid permissions" : nullptr;
+  } else if (signal == SIGBUS) {
+    reason = code == BUS_ADRALN ? "misaligned access" : code == BUS_ADRERR ? "nonexistent address" : nullptr;
+  } else if (signal == SIGFPE) {
+    reason = code == FPE_INTDIV ? "integer divide by zero" : code == FPE_INTOVF ? "integer overflow" : nullptr;
+  } else if (signal == SIGILL) {
+    reason = code == ILL_ILLOPC || code == ILL_ILLOPN ? "illegal instruction" : nullptr;
+  }
+  return reason ? name + " (" + reason + ")" : name;
+}
+
+void FaultGuard::Install() {
+  if (s_Installed) {
+    return;
+  }
+  // backtrace() loads libgcc_s on its first call, which must not happen inside the handler
+  void *warmup[1];
+  backtrace(warmup, 1);
+
+  struct sigaction action {};
+  action.sa_sigaction = Handle;
+  // SA_NODEFER leaves the signal unblocked after the jump, so Run doesn't have to save and restore the mask
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+  sigemptyset(&action.sa_mask);
+  for (const int signal: GUARDED_SIGNALS) {
+    if (sigaction(signal, &action, &s_Previous[signal]) != 0) {
+      std::cerr << "[Fault] Failed to install the " << Describe(signal, 0) << " handler: " << std::strerror(errno)
+                << std::endl;
+    }
+  }
+  s_Installed = true;
+}
+
+// Only the outermost callback of a thread is timed, a guarded call made from inside one is part of it
+void FaultGuard::Enter(Frame &frame) {
+  t_AltStack.Ensure();
+  frame.previous = s_Current;
+  s_Current = &frame;
+  if (!frame.previous) {
+    Watchdog::Beat(frame.ctx, frame.callback);
+  }
+}
+
+void FaultGuard::Leave(Frame &frame) {
+  s_Current = frame.previous;
+  if (!frame.previous) {
+    Watchdog::Rest();
+  }
+}
+
+void FaultGuard::Recover(Frame &frame) {
+  s_Current = frame.previous;
+  if (!frame.previous) {
+    Watchdog::Rest();
+  }
+  std::lock_guard lock(s_FaultsMutex);
+  s_Faults.push_back(frame.fault);
+}
+
+std::vector<FaultGuard::Fault> FaultGuard::TakeFaults() {
+  std::lock_guard lock(s_FaultsMutex);
+  return std::exchange(s_Faults, {});
+}
+
+void FaultGuard::Handle(const int signal, siginfo_t *info, void *ucontext) {
+  Frame *frame = s_Current;
+  if (!frame) {
+    // Emulator code: hand the fault to whoever handled it before us, or crash as usual. A synchronous fault comes
+    // straight back when the instruction is retried, one sent with kill() has to be raised again.
+    sigaction(signal, &s_Previous[signal], nullptr);
+    if (info->si_code <= 0) {
+      raise(signal);
+    }
+    return;
+  }
+
+  Jump(*frame, signal, info->si_code, reinterpret_cast<uintptr_t>(info->si_addr), ucontext);
+}
+
+void FaultGuard::Abandon(const int ms, void *ucontext) {
+  // All the way out, the callback the Watchdog timed is the outermost one
+  Frame *frame = s_Current;
+  while (frame && frame->previous) {
+    frame = frame->previous;
+  }
+  if (frame) {
+    Jump(*frame, HANG, ms, reinterpret_cast<uintptr_t>(faulting_pc(ucontext)), ucontext);
+  }
+}
+
+void FaultGuard::Jump(Frame &frame, const int signal, const int code, const uintptr_t address, void *ucontext) {
+  Fault &fault = frame.fault;
+  fault.ctx = frame.ctx;
+  fault.callback = frame.callback;
+  fault.signal = signal;
+  fault.code = code;
+  fault.address = address;
+
+  // The unwinder walks through the signal trampoline, the faulting instruction marks where the gauge's stack starts
+  void *frames[MAX_DEPTH + 8];
+  const int count = backtrace(frames, MAX_DEPTH + 8);
+  void *pc = faulting_pc(ucontext);
+  const int first = static_cast<int>(std::find(frames, frames + count, pc) - frames);
+  if (first == count) {
+    fault.frames[0] = pc;
+    fault.depth = 1;
+  } else {
+    fault.depth = std::min(count - first, MAX_DEPTH);
+    std::memcpy(fault.frames, frames + first, fault.depth * sizeof(void *));
+  }
+  siglongjmp(frame.env, 1);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Contains crashes in gauge code. Callbacks run through FaultGuard::Run, which arms a jump target on the calling
+// thread; a SIGSEGV, SIGBUS, SIGFPE or SIGILL raised while it is armed records where it happened and siglongjmps back
+// out of the gauge, so only that gauge is lost. The handler runs on an alternate signal stack, stack overflows are
+// recovered from as well. Nothing is unwound: the gauge's destructors don't run and a lock held by it or by code it
+// called into (libc's malloc, the GL driver) stays taken, which is why a faulted gauge is never called again until it
+// is reloaded.
+class FaultGuard {
+  public:
+  enum class Callback { Init, Update, Draw, Mouse, SaveState, Kill };
+  static const char *CallbackName(Callback callback);
+
+  static constexpr int MAX_DEPTH = 32;
+  struct Fault {
+    unsigned long long ctx;
+    Callback callback;
+    int signal;  // HANG when the Watchdog abandoned the callback
+    int code;  // si_code, tells a null deref (SEGV_MAPERR) from a write to read only memory (SEGV_ACCERR); ms for HANG
+    uintptr_t address;  // faulting access for SIGSEGV and SIGBUS, faulting instruction otherwise
+    int depth;
+    void *frames[MAX_DEPTH];  // leaf first, starting at the faulting instruction
+  };
+  static constexpr int HANG = 0;
+  // "SIGSEGV (address not mapped)"
+  static std::string Describe(int signal, int code);
+
+  // Main thread, before the first gauge is loaded. Faults outside gauge code still reach the previous handlers.
+  static void Install();
+
+  // Runs function, returns false when it faulted. The fault is queued for TakeFaults, which the thread owning the
+  // gauges calls afterwards; worker threads can fault concurrently.
+  template<typename F>
+  static bool Run(const unsigned long long ctx, const Callback callback, F &&function) {
+    Frame frame;
+    frame.ctx = ctx;
+    frame.callback = callback;
+    Enter(frame);
+    // No signal mask to save, the handler is installed with SA_NODEFER, which keeps this free of syscalls
+    if (sigsetjmp(frame.env, 0) != 0) {
+      Recover(frame);
+      return false;
+    }
+    function();
+    Leave(frame);
+    return true;
+  }
+
+  static std::vector<Fault> TakeFaults();
+
+  // From a signal handler that interrupted this thread: jumps out of the guarded callback it is running and queues a
+  // HANG fault for it, ms is how long it ran. Returns if no callback is running.
+  static void Abandon(int ms, void *ucontext);
+
+  private:
+  struct Frame {
+    sigjmp_buf env;
+    unsigned long long ctx;
+    Callback callback;
+    Frame *previous;
+    Fault fault;
+  };
+
+  static void Enter(Frame &frame);
+  static void Leave(Frame &frame);
+  static void Recover(Frame &frame);
+  static void Handle(int signal, siginfo_t *info, void *ucontext);
+  [[noreturn]] static void Jump(Frame &frame, int signal, int code, uintptr_t address, void *ucontext);
+
+  static thread_local Frame *s_Current;
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "FsShims/FsStructs.hpp"
+#include "GaugeLoader/CallbackScope.hpp"
+
+struct sEmulatorStateBuffer;
+
+typedef bool (*GaugeInitFunc)(unsigned long long ctx, sGaugeInstallData *install_data);
+typedef bool (*GaugeDrawFunc)(unsigned long long ctx, sGaugeDrawData *draw_data);
+typedef bool (*GaugeKillFunc)(unsigned long long ctx);
+typedef bool (*GaugeUpdateFunc)(unsigned long long ctx, float dTime);
+typedef void (*GaugeMouseHandlerFunc)(unsigned long long ctx, float fX, float fY, int iFlags);
+typedef bool (*GaugePreKillFunc)(unsigned long long ctx);
+typedef bool (*GaugeSaveStateFunc)(unsigned long long ctx, sEmulatorStateBuffer *buffer);
+
+// Exports resolved from one gauge build, everything but init and draw is optional
+struct GaugeCallbacks {
+  GaugeInitFunc init;
+  GaugeDrawFunc draw;
+  GaugeKillFunc kill;
+  GaugeUpdateFunc update;
+  GaugeMouseHandlerFunc mouse_handler;
+  GaugePreKillFunc pre_kill;
+  GaugeSaveStateFunc save_state;  // see include/Emulator.h
+};
+
+// One live gauge instance. The first cache line holds everything the per-frame update/draw/input paths touch, the
+// lifecycle callbacks only used on load and unload live in the second.
+struct alignas(64) GaugeDispatch {
+  enum Flags : uint32_t {
+    PARALLEL_UPDATE = 1 << 0,
+    ALWAYS_REDRAW = 1 << 1,
+    FAULTED = 1 << 2,  // crashed in a callback, see FaultGuard; nothing but dlclose touches it anymore
+  };
+
+  GaugeUpdateFunc update;
+  GaugeDrawFunc draw;
+  GaugeMouseHandlerFunc mouse_handler;
+  unsigned long long ctx;
+  float update_dtime;  // argument of an in-flight pool job, the dispatch entry itself is the job
+  uint32_t flags;
+  uint32_t generation;
+
+  GaugeInitFunc init;
+  GaugeKillFunc kill;
+  GaugePreKillFunc pre_kill;
+  GaugeSaveStateFunc save_state;
+
+  GaugeReadSet reads;  // what the last draw depended on, lets the renderer skip redundant draws
+  std::vector<std::pair<int, double>> writes;  // simvar sets of an update that ran beside others, see UpdateGauges
+};
+static_assert(offsetof(GaugeDispatch, generation) + sizeof(uint32_t) <= 64, "hot dispatch fields must share a line");
+
+// Refers to an arena slot, a handle outlives an unload safely because the slot's generation moves on
+struct GaugeHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+};
+
+// Fixed capacity, never reallocates: pointers into it stay valid while a pool job runs and handles are cheap to copy
+class GaugeArena {
+  public:
+  static constexpr uint32_t CAPACITY = 64;
+
+  GaugeArena()
+      : m_Slots(std::make_unique<GaugeDispatch[]>(CAPACITY)) {
+    m_Free.reserve(CAPACITY);
+    for (uint32_t i = CAPACITY; i > 0; --i) {
+      m_Slots[i - 1].generation = 1;
+      m_Free.push_back(i - 1);
+    }
+    m_Live.reserve(CAPACITY);
+  }
+
+  std::optional<GaugeHandle> Allocate() {
+    if (m_Free.empty()) {
+      return std::nullopt;
+    }
+    const uint32_t index = m_Free.back();
+    m_Free.pop_back();
+    m_Live.push_back(index);
+    return GaugeHandle{index, m_Slots[index].generation};
+  }
+
+  void Free(const GaugeHandle handle) {
+    GaugeDispatch *dispatch = Get(handle);
+    if (!dispatch) {
+      return;
+    }
+    const uint32_t generation = dispatch->generation + 1;
+    *dispatch = GaugeDispatch{};
+    dispatch->generation = generation;
+    std::erase(m_Live, handle.index);
+    m_Free.push_back(handle.index);
+  }
+
+  GaugeDispatch *Get(const GaugeHandle handle) const {
+    if (handle.index >= CAPACITY || m_Slots[handle.index].generation != handle.generation) {
+      return nullptr;
+    }
+    return &m_Slots[handle.index];
+  }
+
+  GaugeDispatch &GetSlot(const uint32_t index) const { return m_Slots[index]; }
+  const std::vector<uint32_t> &GetLive() const { return m_Live; }
+
+  private:
+  std::unique_ptr<GaugeDispatch[]> m_Slots;
+  std::vector<uint32_t> m_Free;
+  std::vector<uint32_t> m_Live;
+};
@@ -0,0 +1,546 @@
+#include "GaugeHost.hpp"
+
+#include "Application/Application.hpp"
+#include "GaugeLoader.hpp"
+#include "Profiling/HeapTracker.hpp"
+//
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <spawn.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+extern char **environ;
+
+bool GaugeHost::s_HostProcess = false;
+
+static constexpr uint32_t SHARED_MAGIC = 0x54534847;  // "GHST"
+static constexpr int HOST_FD = 3;  // where the child finds the shared mapping
+static constexpr uint32_t MIRROR_SLOTS = 4096;
+static constexpr size_t NAME_SIZE = 128;
+static constexpr uint32_t CLICK_QUEUE = 64;
+static constexpr uint32_t FRESH = 4;  // on the middle index: holds a frame the emulator hasn't taken yet
+static constexpr uint32_t INDEX_MASK = 3;
+static constexpr auto FRAME_INTERVAL = std::chrono::microseconds(16667);
+static constexpr auto EXIT_GRACE = std::chrono::seconds(1);
+
+static_assert(std::atomic<double>::is_always_lock_free && std::atomic<float>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory atomics must not fall back to process local locks");
+
+enum class HostState : uint32_t {
+  Starting,  // creating the GL context and loading the gauge
+  Running,
+  Failed,  // the gauge didn't load, see error
+  Faulted,  // the gauge crashed inside the child, see error
+  Stopped,
+};
+
+// Slots are claimed by either side with slot_count and never released, names are written before ready. Each side
+// writes only its own value/version pair and applies the other's when its version moves, so no side ever waits.
+struct MirrorSlot {
+  std::atomic<uint32_t> ready;
+  char name[NAME_SIZE];
+  std::atomic<double> host_value;  // written by the emulator
+  std::atomic<uint64_t> host_version;
+  std::atomic<double> gauge_value;  // written by the child
+  std::atomic<uint64_t> gauge_version;
+};
+
+struct HostClick {
+  float x;
+  float y;
+  int flags;
+};
+
+// Lives at the start of the memfd both processes map, followed by three RGBA frames
+struct HostShared {
+  uint32_t magic;
+  int32_t width;
+  int32_t height;
+  std::atomic<HostState> state;
+  std::atomic<bool> stop;
+  char error[512];  // written before state turns Failed or Faulted
+
+  // Triple buffer: the child owns the back frame, the emulator the front one, the middle index is swapped atomically
+  std::atomic<uint32_t> middle;
+  std::atomic<uint64_t> frames;
+
+  std::atomic<float> mouse_x;
+  std::atomic<float> mouse_y;
+  std::atomic<uint32_t> click_head;  // written by the emulator
+  std::atomic<uint32_t> click_tail;  // written by the child
+  HostClick clicks[CLICK_QUEUE];
+
+  std::atomic<uint32_t> slot_count;
+  MirrorSlot slots[MIRROR_SLOTS];
+};
+
+static constexpr size_t PIXELS_OFFSET = (sizeof(HostShared) + 63) & ~size_t{63};
+
+static size_t frame_bytes(const HostShared &shared) {
+  return static_cast<size_t>(shared.width) * static_cast<size_t>(shared.height) * 4;
+}
+
+static uint8_t *frame_pixels(HostShared *shared, const uint32_t index) {
+  return reinterpret_cast<uint8_t *>(shared) + PIXELS_OFFSET + index * frame_bytes(*shared);
+}
+
+// One side's view of the simvar mirror
+struct HostMirror {
+  bool host = true;  // emulator side, false in the child
+  bool published = false;  // every local variable went out once
+  uint64_t epoch = 0;  // local variable epoch already published
+  uint32_t scanned = 0;  // slots mapped to local ids so far
+  std::vector<int> slot_ids;  // slot -> local variable id
+  std::vector<uint64_t> seen_versions;  // slot -> version of the other side's value last applied
+  std::unordered_map<int, uint32_t> id_slots;  // local variable id -> slot its writes go to
+  bool full_reported = false;
+
+  void Publish(HostShared &shared, GaugeLoader &loader, const int id, const double value) {
+    uint32_t slot;
+    if (const auto it = id_slots.find(id); it != id_slots.end()) {
+      slot = it->second;
+    } else {
+      const std::string &name = loader.GetVariableName(id);
+      if (name.empty() || name.size() >= NAME_SIZE) {
+        return;
+      }
+      slot = shared.slot_count.fetch_add(1, std::memory_order_relaxed);
+      if (slot >= MIRROR_SLOTS) {
+        if (!full_reported) {
+          std::cerr << "[Host] More than " << MIRROR_SLOTS << " simvars, " << name << " and later ones aren't mirrored"
+                    << std::endl;
+          full_reported = true;
+        }
+        return;
+      }
+      std::memcpy(shared.slots[slot].name, name.c_str(), name.size() + 1);
+      shared.slots[slot].ready.store(1, std::memory_order_release);
+      id_slots.emplace(id, slot);
+    }
+    MirrorSlot &entry = shared.slots[slot];
+    (host ? entry.host_value : entry.gauge_value).store(value, std::memory_order_relaxed);
+    (host ? entry.host_version : entry.gauge_version).fetch_add(1, std::memory_order_release);
+  }
+
+  // When both sides write the same simvar in the same frame each ends up with the other's value until the next write
+  void Sync(HostShared &shared, GaugeLoader &loader) {
+    std::vector<GaugeLoader::VariableChange> changes;
+    if (published && loader.GetChangesSince(epoch, changes)) {
+      for (const auto &change: changes) {
+        Publish(shared, loader, change.id, change.value);
+      }
+    } else {
+      // Variables added with a value never went through the change log, neither did whatever the log dropped since
+      for (int id = 0; id < static_cast<int>(loader.GetVariableCount()); id++) {
+        Publish(shared, loader, id, loader.GetVariable(id));
+      }
+      published = true;
+    }
+
+    const uint32_t count = std::min(shared.slot_count.load(std::memory_order_relaxed), MIRROR_SLOTS);
+    while (scanned < count && shared.slots[scanned].ready.load(std::memory_order_acquire)) {
+      const int id = loader.AddVariable(shared.slots[scanned].name, 0.0);
+      id_slots.try_emplace(id, scanned);
+      slot_ids.push_back(id);
+      seen_versions.push_back(0);
+      scanned++;
+    }
+    for (uint32_t slot = 0; slot < scanned; slot++) {
+      const MirrorSlot &entry = shared.slots[slot];
+      const uint64_t version = (host ? entry.gauge_version : entry.host_version).load(std::memory_order_acquire);
+      if (version != seen_versions[slot]) {
+        seen_versions[slot] = version;
+        loader.UpdateVariable(slot_ids[slot], (host ? entry.gauge_value : entry.host_value).load());
+      }
+    }
+    // What was just applied came from the other side, it must not be published back
+    epoch = loader.GetVariableEpoch();
+  }
+};
+
+static std::string join_error(const std::string &what) { return what + ": " + std::strerror(errno); }
+
+static bool write_file(const std::filesystem::path &path, const std::string &contents) {
+  std::ofstream file(path);
+  file << contents;
+  file.flush();
+  return file.good();
+}
+
+// Limits that rlimits can't express go through a cgroup v2 directory the user delegated to the emulator
+static std::string create_cgroup(const std::string &gauge_name, const pid_t pid, const GaugeHost::Limits &limits) {
+  if (limits.cpu_percent <= 0 && limits.memory_bytes == 0) {
+    return "";
+  }
+  const char *root = std::getenv("FS_EMULATOR_CGROUP");
+  if (!root) {
+    if (limits.cpu_percent > 0) {
+      std::cerr << "[Host] host_cpu_percent of " << gauge_name
+                << " needs FS_EMULATOR_CGROUP pointing at a writable cgroup v2 directory, running unthrottled"
+                << std::endl;
+    }
+    return "";
+  }
+  const std::filesystem::path path =
+      std::filesystem::path(root) / ("gauge-" + gauge_name + "-" + std::to_string(pid));
+  std::error_code error;
+  if (!std::filesystem::create_directory(path, error) || error) {
+    std::cerr << "[Host] Failed to create cgroup " << path << ": " << error.message() << std::endl;
+    return "";
+  }
+  bool applied = true;
+  if (limits.cpu_percent > 0) {
+    // Quota per 100 ms period, above 100% the child may use more than one core
+    applied &= write_file(path / "cpu.max", std::to_string(limits.cpu_percent * 1000) + " 100000");
+  }
+  if (limits.memory_bytes > 0) {
+    applied &= write_file(path / "memory.max", std::to_string(limits.memory_bytes));
+  }
+  applied &= write_file(path / "cgroup.procs", std::to_string(pid));
+  if (!applied) {
+    std::cerr << "[Host] Failed to apply the limits in " << path << ", are the cpu and memory controllers enabled?"
+              << std::endl;
+  }
+  return path.string();
+}
+
+GaugeHost::GaugeHost() = default;
+
+std::expected<std::unique_ptr<GaugeHost>, std::string> GaugeHost::Spawn(const std::string &gauge_path,
+                                                                         const std::string &gauge_name,
+                                                                         const int width, const int height,
+                                                                         const Limits &limits) {
+  if (width <= 0 || height <= 0) {
+    return std::unexpected("Invalid gauge size " + std::to_string(width) + "x" + std::to_string(height));
+  }
+  int fd = memfd_create(("gauge-host-" + gauge_name).c_str(), MFD_CLOEXEC);
+  if (fd < 0) {
+    return std::unexpected(join_error("memfd_create failed"));
+  }
+  // dup2 onto itself would keep FD_CLOEXEC and the child would find nothing there
+  if (fd == HOST_FD) {
+    const int moved = fcntl(fd, F_DUPFD_CLOEXEC, HOST_FD + 1);
+    close(fd);
+    fd = moved;
+  }
+  const size_t size = PIXELS_OFFSET + 3 * static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+  if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    const std::string error = join_error("Failed to size the shared memory");
+    if (fd >= 0) close(fd);
+    return std::unexpected(error);
+  }
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    const std::string error = join_error("Failed to map the shared memory");
+    close(fd);
+    return std::unexpected(error);
+  }
+
+  auto host = std::unique_ptr<GaugeHost>(new GaugeHost());
+  host->m_Shared = new (memory) HostShared{};
+  host->m_MappingSize = size;
+  host->m_Name = gauge_name;
+  host->m_Front = 0;
+  host->m_Mirror = std::make_unique<HostMirror>();
+  host->m_Mirror->host = true;
+  HostShared &shared = *host->m_Shared;
+  shared.magic = SHARED_MAGIC;
+  shared.width = width;
+  shared.height = height;
+  shared.middle = 1;
+
+  const std::string memory_mb = std::to_string(limits.memory_bytes / (1024 * 1024));
+  const std::string host_fd = std::to_string(HOST_FD);
+  const char *argv[] = {"/proc/self/exe",  "--host-gauge", gauge_path.c_str(), "--host-name", gauge_name.c_str(),
+                        "--host-fd",       host_fd.c_str(), "--host-memory-mb", memory_mb.c_str(), nullptr};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fd, HOST_FD);
+  const int result = posix_spawn(&host->m_Pid, "/proc/self/exe", &actions, nullptr, const_cast<char **>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  // The mapping stays valid without the descriptor
+  close(fd);
+  if (result != 0) {
+    host->m_Exited = true;
+    return std::unexpected(std::string("Failed to start the gauge host: ") + std::strerror(result));
+  }
+
+  host->m_Cgroup = create_cgroup(gauge_name, host->m_Pid, limits);
+  std::cout << "[Host] Started " << gauge_name << " in process " << host->m_Pid << std::endl;
+  return host;
+}
+
+GaugeHost::~GaugeHost() {
+  if (!m_Shared) {
+    return;
+  }
+  m_Shared->stop.store(true, std::memory_order_release);
+  munmap(m_Shared, m_MappingSize);
+  if (m_Exited && m_Cgroup.empty()) {
+    return;
+  }
+  // Runs off the main thread, a child stuck in its gauge's kill must not stall a reload
+  std::thread([pid = m_Pid, exited = m_Exited, cgroup = m_Cgroup] {
+    if (!exited) {
+      const auto deadline = std::chrono::steady_clock::now() + EXIT_GRACE;
+      bool reaped = false;
+      while (!reaped && std::chrono::steady_clock::now() < deadline) {
+        reaped = waitpid(pid, nullptr, WNOHANG) == pid;
+        if (!reaped) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+      }
+      if (!reaped) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+      }
+    }
+    if (!cgroup.empty()) {
+      rmdir(cgroup.c_str());
+    }
+  }).detach();
+}
+
+std::optional<std::string> GaugeHost::Poll(GaugeLoader &loader) {
+  if (m_Reported) {
+    return std::nullopt;
+  }
+  std::string error;
+  int status = 0;
+  if (!m_Exited && waitpid(m_Pid, &status, WNOHANG) == m_Pid) {
+    m_Exited = true;
+    if (WIFSIGNALED(status)) {
+      error = std::string("host process killed by SIG") + sigabbrev_np(WTERMSIG(status));
+    } else {
+      error = "host process exited with status " + std::to_string(WEXITSTATUS(status));
+    }
+  }
+  const HostState state = m_Shared->state.load(std::memory_order_acquire);
+  if (state == HostState::Failed || state == HostState::Faulted) {
+    error = std::string(m_Shared->error, strnlen(m_Shared->error, sizeof(m_Shared->error)));
+  }
+  if (!error.empty()) {
+    m_Reported = true;
+    return error;
+  }
+  m_Mirror->Sync(*m_Shared, loader);
+  return std::nullopt;
+}
+
+bool GaugeHost::UploadFrame(const unsigned int texture) {
+  if (!(m_Shared->middle.load(std::memory_order_acquire) & FRESH)) {
+    return false;
+  }
+  m_Front = m_Shared->middle.exchange(m_Front, std::memory_order_acq_rel) & INDEX_MASK;
+
+  GLint last_texture;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_Shared->width, m_Shared->height, GL_RGBA, GL_UNSIGNED_BYTE,
+                  frame_pixels(m_Shared, m_Front));
+  glBindTexture(GL_TEXTURE_2D, last_texture);
+  return true;
+}
+
+void GaugeHost::SetMousePosition(const float x, const float y) {
+  m_Shared->mouse_x.store(x, std::memory_order_relaxed);
+  m_Shared->mouse_y.store(y, std::memory_order_relaxed);
+}
+
+void GaugeHost::PushClick(const float x, const float y, const int flags) {
+  const uint32_t head = m_Shared->click_head.load(std::memory_order_relaxed);
+  if (head - m_Shared->click_tail.load(std::memory_order_acquire) >= CLICK_QUEUE) {
+    return;  // the child isn't keeping up, drop rather than wait
+  }
+  m_Shared->clicks[head % CLICK_QUEUE] = HostClick{x, y, flags};
+  m_Shared->click_head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t GaugeHost::GetFrameCount() const { return m_Shared->frames.load(std::memory_order_relaxed); }
+
+bool GaugeHost::IsHostCommandLine(const int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view(argv[i]) == "--host-gauge") {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Address space this process has mapped right now, in bytes
+static rlim_t read_vm_size() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.starts_with("VmSize:")) {
+      return static_cast<rlim_t>(std::strtoull(line.c_str() + 7, nullptr, 10)) * 1024;
+    }
+  }
+  return 0;
+}
+
+static void fail_child(HostShared &shared, const HostState state, const std::string &error) {
+  const size_t length = std::min(error.size(), sizeof(shared.error) - 1);
+  std::memcpy(shared.error, error.data(), length);
+  shared.error[length] = '\0';
+  shared.state.store(state, std::memory_order_release);
+  std::cerr << "[Host] " << error << std::endl;
+}
+
+int GaugeHost::RunChild(const int argc, char **argv) {
+  s_HostProcess = true;
+  // Never outlive the emulator, it is the only one that would ever reap or stop us
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  if (getppid() == 1) {
+    return 1;
+  }
+
+  std::string gauge_path, gauge_name;
+  int fd = -1;
+  size_t memory_mb = 0;
+  for (int i = 1; i + 1 < argc; i++) {
+    const std::string_view arg = argv[i];
+    const std::string_view value = argv[i + 1];
+    if (arg == "--host-gauge") {
+      gauge_path = value;
+    } else if (arg == "--host-name") {
+      gauge_name = value;
+    } else if (arg == "--host-fd") {
+      std::from_chars(value.data(), value.data() + value.size(), fd);
+    } else if (arg == "--host-memory-mb") {
+      std::from_chars(value.data(), value.data() + value.size(), memory_mb);
+    } else {
+      continue;
+    }
+    i++;
+  }
+
+  struct stat info {};
+  if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < PIXELS_OFFSET) {
+    std::cerr << "[Host] No shared memory on fd " << fd << ", --host-gauge is started by the emulator" << std::endl;
+    return 1;
+  }
+  void *memory = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED || static_cast<HostShared *>(memory)->magic != SHARED_MAGIC) {
+    std::cerr << "[Host] Shared memory of " << gauge_name << " is not a gauge host mapping" << std::endl;
+    return 1;
+  }
+  HostShared &shared = *static_cast<HostShared *>(memory);
+
+  // RLIMIT_AS caps the whole address space, so the budget goes on top of what is mapped already: the executable, its
+  // libraries, the GL driver and the shared frames. Only what the gauge maps from here on is left to count against it.
+  if (memory_mb > 0) {
+    const rlim_t bytes = read_vm_size() + memory_mb * 1024 * 1024;
+    const rlimit limit{bytes, bytes};
+    if (setrlimit(RLIMIT_AS, &limit) != 0) {
+      std::cerr << "[Host] " << join_error("setrlimit failed") << std::endl;
+    }
+  }
+
+  auto loader = GaugeLoader::GetInstance();
+  // The emulator watches the file and replaces this whole process on a rebuild
+  loader->SetWatchFiles(false);
+  GaugeHandle handle;
+  try {
+    handle = loader->GetOrLoadGauge(gauge_path, gauge_name);
+  } catch (const std::exception &e) {
+    fail_child(shared, HostState::Failed, e.what());
+    return 2;
+  }
+  if (loader->GetAllRenderers().empty()) {
+    fail_child(shared, HostState::Failed, "Gauge " + gauge_name + " has no renderer");
+    return 2;
+  }
+  InstrumentRenderer &renderer = loader->GetAllRenderers().front();
+
+  HostMirror mirror;
+  mirror.host = false;
+  uint32_t back = 2;
+  ImVec2 last_mouse{-1.0f, -1.0f};
+  auto last_frame = std::chrono::steady_clock::now();
+  if (loader->GetFaults().empty()) {
+    shared.state.store(HostState::Running, std::memory_order_release);
+  }
+  while (loader->GetFaults().empty() && !shared.stop.load(std::memory_order_acquire)) {
+    const auto frame_start = std::chrono::steady_clock::now();
+    const float dtime = std::chrono::duration<float>(frame_start - last_frame).count();
+    last_frame = frame_start;
+
+    mirror.Sync(shared, *loader);
+
+    // RenderContents reads the hover position from ImGui, which is never fed input in here
+    const ImVec2 mouse{shared.mouse_x.load(std::memory_order_relaxed), shared.mouse_y.load(std::memory_order_relaxed)};
+    ImGui::GetIO().MousePos = mouse;
+    bool input = mouse.x != last_mouse.x || mouse.y != last_mouse.y;
+    last_mouse = mouse;
+    const uint32_t head = shared.click_head.load(std::memory_order_acquire);
+    for (uint32_t tail = shared.click_tail.load(std::memory_order_relaxed); tail != head; tail++) {
+      const HostClick click = shared.clicks[tail % CLICK_QUEUE];
+      shared.click_tail.store(tail + 1, std::memory_order_release);
+      GaugeDispatch *dispatch = loader->GetDispatch(handle);
+      if (dispatch && dispatch->mouse_handler && !(dispatch->flags & GaugeDispatch::FAULTED)) {
+        CallbackScope scope(dispatch->ctx, &dispatch->reads, false);
+        if (!FaultGuard::Run(dispatch->ctx, FaultGuard::Callback::Mouse,
+                             [&] { dispatch->mouse_handler(dispatch->ctx, click.x, click.y, click.flags); })) {
+          loader->ProcessFaults();
+        }
+      }
+      input = true;
+    }
+
+    HeapTracker::GetInstance()->EndFrame();
+    loader->UpdateGauges(dtime);
+    const uint64_t drawn = loader->GetDrawStats().drawn;
+    renderer.RenderOffscreen(input);
+    if (loader->GetDrawStats().drawn != drawn) {
+      if (renderer.GetFramebufferWidth() != shared.width || renderer.GetFramebufferHeight() != shared.height) {
+        fail_child(shared, HostState::Failed, "Gauge " + gauge_name + " changed its size, reload it");
+        break;
+      }
+      // A synchronous read stalls only this process, the emulator keeps showing the previous frame meanwhile
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.GetFramebuffer());
+      glReadPixels(0, 0, shared.width, shared.height, GL_RGBA, GL_UNSIGNED_BYTE, frame_pixels(&shared, back));
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+      back = shared.middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+      shared.frames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Hidden windows still have to answer the compositor
+    glfwPollEvents();
+    std::this_thread::sleep_until(frame_start + FRAME_INTERVAL);
+  }
+
+  int exit_code = 0;
+  if (!loader->GetFaults().empty()) {
+    const auto &[name, fault] = *loader->GetFaults().begin();
+    fail_child(shared, HostState::Faulted, name + " crashed: " + fault);
+    exit_code = 3;
+  }
+  if (auto result = loader->UnloadAllGauges(); !result.has_value()) {
+    std::cerr << "[Host] " << result.error() << std::endl;
+  }
+  if (exit_code == 0 && shared.state.load() == HostState::Running) {
+    shared.state.store(HostState::Stopped, std::memory_order_release);
+  }
+  return exit_code;
+}
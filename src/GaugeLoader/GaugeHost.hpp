@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+
+class GaugeLoader;
+struct HostShared;
+struct HostMirror;
+
+// Runs one gauge in a child process, for gauges with "isolation": "process". The child is this executable started
+// with --host-gauge: it loads the gauge the usual way behind a hidden window's GL context, renders it offscreen at its
+// json size and publishes each new image into a shared memory triple buffer, from which the emulator copies the newest
+// one into the gauge's texture. Simvars are mirrored through the same mapping in both directions, mouse input goes the
+// other way. The emulator never waits for the child: a slow child just shows an older frame, and a child that dies or
+// whose gauge crashes is reported like a crashed gauge (see FaultGuard).
+class GaugeHost {
+  public:
+  struct Limits {
+    size_t memory_bytes;  // address space the child may map past its own, and memory.max of its cgroup; 0 for none
+    int cpu_percent;  // of one core through cpu.max of the child's cgroup, needs FS_EMULATOR_CGROUP, 0 for none
+  };
+
+  // Main thread. Returns once the child is started, it loads the gauge on its own time.
+  static std::expected<std::unique_ptr<GaugeHost>, std::string> Spawn(const std::string &gauge_path,
+                                                                      const std::string &gauge_name, int width,
+                                                                      int height, const Limits &limits);
+  // Asks the child to unload its gauge and exit; a reaper thread kills it if it doesn't within a second
+  ~GaugeHost();
+
+  GaugeHost(const GaugeHost &) = delete;
+  GaugeHost &operator=(const GaugeHost &) = delete;
+
+  // Main thread, once per frame: mirrors simvars both ways and checks on the child. Returns what went wrong, once,
+  // when the child died or its gauge crashed.
+  std::optional<std::string> Poll(GaugeLoader &loader);
+  // Copies the newest frame into texture (RGBA8, the gauge's json size) if the child published one since the last
+  // call. GL texture binding is preserved.
+  bool UploadFrame(unsigned int texture);
+  // Gauge local coordinates, the hover position ends up in draw_data
+  void SetMousePosition(float x, float y);
+  void PushClick(float x, float y, int flags);
+
+  pid_t GetPid() const { return m_Pid; }
+  uint64_t GetFrameCount() const;  // published by the child so far
+
+  // Child side, called from EntryPoint once the (hidden) application exists. Returns the exit code.
+  static bool IsHostCommandLine(int argc, char **argv);
+  static int RunChild(int argc, char **argv);
+  // True inside a child, where process isolated gauges are loaded in-process
+  static bool IsHostProcess() { return s_HostProcess; }
+
+  private:
+  GaugeHost();
+
+  HostShared *m_Shared = nullptr;
+  size_t m_MappingSize = 0;
+  pid_t m_Pid = -1;
+  bool m_Exited = false;
+  bool m_Reported = false;
+  uint32_t m_Front = 0;  // triple buffer index the emulator reads from
+  std::string m_Name;
+  std::string m_Cgroup;  // created for the child's limits, removed by the reaper
+  std::unique_ptr<HostMirror> m_Mirror;
+
+  static bool s_HostProcess;
+};
@@ -0,0 +1,158 @@
+#include "GaugeLinker.hpp"
+
+#include "ElfFile.hpp"
+//
+#include <cstring>
+#include <dlfcn.h>
+#include <elf.h>
+#include <iostream>
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::optional<GaugeIsolation> GaugeLinker::ParseIsolation(const std::string_view name) {
+  if (name == "global") return GaugeIsolation::Global;
+  if (name == "local") return GaugeIsolation::Local;
+  if (name == "deepbind") return GaugeIsolation::DeepBind;
+  if (name == "namespace") return GaugeIsolation::Namespace;
+  if (name == "process") return GaugeIsolation::Process;
+  return std::nullopt;
+}
+
+const char *GaugeLinker::IsolationName(const GaugeIsolation isolation) {
+  switch (isolation) {
+    case GaugeIsolation::Global:
+      return "global";
+    case GaugeIsolation::Local:
+      return "local";
+    case GaugeIsolation::DeepBind:
+      return "deepbind";
+    case GaugeIsolation::Namespace:
+      return "namespace";
+    case GaugeIsolation::Process:
+      return "process";
+  }
+  return "";
+}
+
+bool GaugeLinker::IsEmulatorApi(const std::string_view name) {
+  // The APIs are camel case, a lowercase prefix alone would also take libc's fseek, fstat, fsync, glob and friends
+  static constexpr std::string_view prefixes[] = {"fs", "nvg", "gl", "glew", "__glew"};
+  for (const auto prefix: prefixes) {
+    if (name.size() > prefix.size() && name.starts_with(prefix) && name[prefix.size()] >= 'A' &&
+        name[prefix.size()] <= 'Z') {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GaugeLinker::IsAllocator(const std::string_view name) {
+  static constexpr std::string_view allocators[] = {"malloc",        "calloc",         "realloc", "reallocarray",
+                                                    "free",          "memalign",       "valloc",  "pvalloc",
+                                                    "aligned_alloc", "posix_memalign", "malloc_usable_size"};
+  for (const auto allocator: allocators) {
+    if (name == allocator) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::expected<void *, std::string> GaugeLinker::Open(const std::string &path, const ElfFile &elf,
+                                                     const GaugeIsolation isolation, const bool bind_now) {
+  const int binding = bind_now ? RTLD_NOW : RTLD_LAZY;
+  void *handle = nullptr;
+  switch (isolation) {
+    case GaugeIsolation::Global:
+      handle = dlopen(path.c_str(), binding | RTLD_GLOBAL);
+      break;
+    case GaugeIsolation::Local:
+    case GaugeIsolation::Process:
+      handle = dlopen(path.c_str(), binding | RTLD_LOCAL);
+      break;
+    case GaugeIsolation::DeepBind:
+      handle = dlopen(path.c_str(), binding | RTLD_LOCAL | RTLD_DEEPBIND);
+      // Blocks allocated through libc directly until here (static initializers) are still freed correctly
+      if (handle) {
+        if (auto patched = PatchImports(handle, elf, IsAllocator, "allocator"); !patched.has_value()) {
+          dlclose(handle);
+          return std::unexpected(patched.error());
+        }
+      }
+      break;
+    case GaugeIsolation::Namespace:
+      // The emulator API can't be resolved inside the new namespace, it is patched in below, so binding has to be lazy
+      handle = dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+      // No fallback: loading without the isolation that was asked for would hide the clashes it exists to prevent
+      if (!handle) {
+        return std::unexpected(std::string("dlmopen failed: ") + dlerror());
+      }
+      if (auto patched = PatchImports(handle, elf, IsEmulatorApi, "emulator API"); !patched.has_value()) {
+        dlclose(handle);
+        return std::unexpected(patched.error());
+      }
+      break;
+  }
+
+  if (!handle) {
+    return std::unexpected(std::string(dlerror()));
+  }
+  return handle;
+}
+
+std::expected<void, std::string> GaugeLinker::PatchImports(void *handle, const ElfFile &elf,
+                                                          bool (*filter)(const std::string_view), const char *what) {
+  link_map *map = nullptr;
+  if (dlinfo(handle, RTLD_DI_LINKMAP, &map) != 0 || !map) {
+    return std::unexpected(std::string("dlinfo failed: ") + dlerror());
+  }
+  const auto base = static_cast<uintptr_t>(map->l_addr);
+  const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const auto [relro_offset, relro_size] = elf.GetRelroRange();
+
+#if defined(__x86_64__)
+  const auto is_patchable = [](const uint32_t type) {
+    return type == R_X86_64_JUMP_SLOT || type == R_X86_64_GLOB_DAT || type == R_X86_64_64;
+  };
+#elif defined(__aarch64__)
+  const auto is_patchable = [](const uint32_t type) {
+    return type == R_AARCH64_JUMP_SLOT || type == R_AARCH64_GLOB_DAT || type == R_AARCH64_ABS64;
+  };
+#else
+  const auto is_patchable = [](uint32_t) { return false; };
+#endif
+
+  // RELRO is already read-only by the time dlopen returns, open it up for the duration of the patch
+  const uintptr_t relro_begin = (base + relro_offset) & ~(page_size - 1);
+  const uintptr_t relro_end = base + relro_offset + relro_size;
+  if (relro_size > 0 &&
+      mprotect(reinterpret_cast<void *>(relro_begin), relro_end - relro_begin, PROT_READ | PROT_WRITE) != 0) {
+    return std::unexpected(std::string("mprotect failed: ") + std::strerror(errno));
+  }
+
+  size_t patched = 0;
+  std::string missing;
+  for (const auto &relocation: elf.GetSymbolRelocations()) {
+    if (!is_patchable(relocation.type) || !filter(relocation.symbol)) {
+      continue;
+    }
+    void *address = dlsym(RTLD_DEFAULT, relocation.symbol.c_str());
+    if (!address) {
+      missing += (missing.empty() ? "" : ", ") + relocation.symbol;
+      continue;
+    }
+    const uintptr_t value = reinterpret_cast<uintptr_t>(address) + relocation.addend;
+    std::memcpy(reinterpret_cast<void *>(base + relocation.offset), &value, sizeof(value));
+    patched++;
+  }
+
+  if (relro_size > 0) {
+    mprotect(reinterpret_cast<void *>(relro_begin), relro_end - relro_begin, PROT_READ);
+  }
+  if (!missing.empty()) {
+    std::cerr << "[Linker] Left unpatched (not exported by the emulator): " << missing << std::endl;
+  }
+  std::cout << "[Linker] Patched " << patched << " " << what << " relocations" << std::endl;
+  return {};
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class ElfFile;
+
+// How a gauge's symbols are kept apart from the emulator and from other gauges, set per gauge with "isolation"
+enum class GaugeIsolation {
+  Global,  // RTLD_GLOBAL, the gauge's exports are visible to (and interpose on) every later gauge
+  Local,  // RTLD_LOCAL, exports stay private but the gauge still resolves against everything global first
+  DeepBind,  // RTLD_LOCAL | RTLD_DEEPBIND, the gauge prefers its own definitions over global ones
+  Namespace,  // dlmopen into a fresh link-map namespace, only the emulator API is patched in from outside
+  Process,  // a child process of its own, see GaugeHost; inside that process the gauge is opened like a Local one
+};
+
+// Opens gauge libraries according to their isolation mode
+class GaugeLinker {
+  public:
+  static std::optional<GaugeIsolation> ParseIsolation(std::string_view name);
+  static const char *IsolationName(GaugeIsolation isolation);
+
+  // elf must be the parsed contents of path, its relocations drive the API patching in Namespace mode
+  static std::expected<void *, std::string> Open(const std::string &path, const ElfFile &elf, GaugeIsolation isolation,
+                                                 bool bind_now);
+
+  // Symbols that must come from the emulator's own namespace: the MSFS API, NanoVG and GL (a second libGL inside the
+  // namespace would have no current context)
+  static bool IsEmulatorApi(std::string_view name);
+  // malloc and friends, which RTLD_DEEPBIND would otherwise bind to libc past the emulator's heap accounting
+  static bool IsAllocator(std::string_view name);
+
+  private:
+  // Points the gauge's relocations against symbols matching filter at the emulator's definitions
+  static std::expected<void, std::string> PatchImports(void *handle, const ElfFile &elf,
+                                                       bool (*filter)(std::string_view), const char *what);
+};
@@ -1,205 +1,1057 @@
 #include "GaugeLoader.hpp"
 
 #include "Application/Application.hpp"
+#include "ElfFile.hpp"
+#include "FaultGuard.hpp"
 #include "FileDialog/FileDialog.hpp"
+#include "GaugeLinker.hpp"
+#include "Profiling/HeapTracker.hpp"
+#include "Profiling/SamplingProfiler.hpp"
+#include "ShadowCopy.hpp"
 //
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <dlfcn.h>
 #include <iostream>
+#include <link.h>
 #include <ostream>
 #include <ranges>
 #include <stdexcept>
 #include <thread>
+#include <utility>
 
 #include "nanovg.h"
 
 GaugeLoader *GaugeLoader::m_Instance = nullptr;
-
-ImVec2 InstrumentRenderer::m_Position = {0.0f, 0.0f};
-ImVec2 InstrumentRenderer::m_Size = {0.0f, 0.0f};
+thread_local std::vector<std::pair<int, double>> *GaugeLoader::s_DeferredWrites = nullptr;
 
 static unsigned long long base_ctx = 1;
 
 
-void reload_gauge(const std::string &gauge_name, const std::string &gauge_path) {
-  auto gauge_loader = GaugeLoader::GetInstance();
-  gauge_loader->UnloadAllGauges();
-  std::thread([gauge_path, gauge_name]() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));  // Wait for this shit to work
-    std::cout << "reloading: " << gauge_path << " " << gauge_name << std::endl;
-    try {
-      //  GaugeLoader::GetInstance()->GetOrLoadGauge(gauge_path, gauge_name);
-      GaugeLoader::GetInstance()->SetUpdateQueued(true);
-    } catch (const std::exception &e) {
-      std::cerr << "Error loading gauge: " << e.what() << std::endl;
-    }
-  }).detach();
+static constexpr auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+static constexpr int STABLE_POLLS = 2;  // mtime and size must hold still this many polls before a reload starts
+
+static std::optional<std::pair<std::filesystem::file_time_type, uintmax_t>> file_stamp(
+    const std::filesystem::path &path) {
+  std::error_code error_code;
+  const auto write_time = std::filesystem::last_write_time(path, error_code);
+  if (error_code) {
+    return std::nullopt;
+  }
+  const auto size = std::filesystem::file_size(path, error_code);
+  if (error_code) {
+    return std::nullopt;
+  }
+  return std::make_pair(write_time, size);
 }
 
-void start_gauge_watcher(const std::filesystem::path &gauge_path, const std::string &gauge_name) {
-  std::thread([gauge_path, gauge_name]() {
+void start_gauge_watcher(const std::filesystem::path &gauge_path, const std::string &gauge_name,
+                         std::shared_ptr<std::atomic<bool>> stop) {
+  std::thread([gauge_path, gauge_name, stop]() {
     std::cout << "[Watcher] Started for " << gauge_name << std::endl;
-    std::error_code error_code;
-    auto last_write_time = std::filesystem::last_write_time(gauge_path, error_code);
+    auto last_stamp = file_stamp(gauge_path);
+    bool pending = false;
+    int stable_polls = 0;
 
-    while (true) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    while (!*stop) {
+      std::this_thread::sleep_for(WATCH_INTERVAL);
 
-      auto current_time = std::filesystem::last_write_time(gauge_path, error_code);
-      if (error_code) {
-        std::cerr << "[Watcher] Error checking file: " << error_code.message() << std::endl;
+      // A missing file is normal while the linker replaces it, just keep polling
+      const auto stamp = file_stamp(gauge_path);
+      if (!stamp.has_value()) {
+        continue;
+      }
+      if (stamp != last_stamp) {
+        last_stamp = stamp;
+        pending = true;
+        stable_polls = 0;
+        continue;
+      }
+      if (!pending || ++stable_polls < STABLE_POLLS) {
         continue;
       }
-      if (current_time != last_write_time) {
-        std::cout << "[Watcher] File changed: " << gauge_name << std::endl;
-        last_write_time = current_time;
+      pending = false;
 
-        std::thread([gauge_path, gauge_name]() { reload_gauge(gauge_name, gauge_path); }).detach();
-        return;
+      std::cout << "[Watcher] File changed: " << gauge_name << std::endl;
+      auto shadow = ShadowCopy::Create(gauge_path.string());
+      if (!shadow.has_value()) {
+        // Most likely still being written, the next write will trigger another attempt
+        std::cerr << "[Watcher] Skipping reload: " << shadow.error() << std::endl;
+        continue;
       }
+
+      // kill/init touch the gauge's GL resources, so the swap itself has to happen on the main thread
+      Application::Get().value()->QueueEvent([gauge_path, gauge_name, stop, shadow = shadow.value()]() {
+        if (*stop) {
+          ShadowCopy::Remove(shadow.path);
+          return;
+        }
+        std::cout << "reloading: " << gauge_path << " " << gauge_name << std::endl;
+        GaugeLoader::GetInstance()->RequestLoad(gauge_path.string(), gauge_name, shadow);
+      });
     }
+    std::cout << "[Watcher] Stopped for " << gauge_name << std::endl;
   }).detach();
-  ;
 }
 
-std::expected<std::pair<unsigned long long, GaugeLoader::Gauge>, std::string> GaugeLoader::LoadGauge(
-    const std::string &gauge_path, const std::string &gauge_name) {
-  void *handle = dlopen(gauge_path.c_str(), RTLD_LAZY | RTLD_GLOBAL);
-  if (!handle) {
-    return std::unexpected(std::string("Failed to load gauge: ") + dlerror());
+const char *GaugeLoader::PendingLoad::PhaseName(const Phase phase) {
+  switch (phase) {
+    case Phase::Copying:
+      return "Copying";
+    case Phase::Parsing:
+      return "Parsing JSON";
+    case Phase::CheckingImports:
+      return "Checking imports";
+    case Phase::Opening:
+      return "Opening";
+    case Phase::Resolving:
+      return "Resolving symbols";
+    case Phase::Initializing:
+      return "Waiting for init";
+  }
+  return "";
+}
+
+static void set_phase(GaugeLoader::PendingLoad *progress, const GaugeLoader::PendingLoad::Phase phase) {
+  if (progress) {
+    progress->phase = phase;
+    Application::RequestRedraw();
+  }
+}
+
+// Executable segments of a loaded library, return addresses inside them belong to the gauge's own code
+static std::pair<uintptr_t, uintptr_t> code_range(void *handle) {
+  link_map *map = nullptr;
+  if (dlinfo(handle, RTLD_DI_LINKMAP, &map) != 0 || !map) {
+    return {0, 0};
+  }
+  struct Search {
+    const link_map *map;
+    uintptr_t begin;
+    uintptr_t end;
+  } search{map, UINTPTR_MAX, 0};
+  dl_iterate_phdr(
+      [](dl_phdr_info *info, size_t, void *data) {
+        auto *search = static_cast<Search *>(data);
+        if (info->dlpi_addr != search->map->l_addr || std::strcmp(info->dlpi_name, search->map->l_name) != 0) {
+          return 0;
+        }
+        for (int i = 0; i < info->dlpi_phnum; i++) {
+          const ElfW(Phdr) &header = info->dlpi_phdr[i];
+          if (header.p_type == PT_LOAD && (header.p_flags & PF_X)) {
+            search->begin = std::min<uintptr_t>(search->begin, info->dlpi_addr + header.p_vaddr);
+            search->end = std::max<uintptr_t>(search->end, info->dlpi_addr + header.p_vaddr + header.p_memsz);
+          }
+        }
+        return 1;
+      },
+      &search);
+  return search.end != 0 ? std::pair{search.begin, search.end} : std::pair<uintptr_t, uintptr_t>{0, 0};
+}
+
+// Milliseconds since mark, which then moves on to now
+static double lap_ms(std::chrono::steady_clock::time_point &mark) {
+  const auto now = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double, std::milli>(now - mark).count();
+  mark = now;
+  return elapsed;
+}
+
+static void discard_gauge(const GaugeLoader::Gauge &gauge) {
+  // Hosted gauges were never opened in this process
+  if (gauge.handle) {
+    dlclose(gauge.handle);
+  }
+  if (!gauge.shadow_path.empty()) {
+    ShadowCopy::Remove(gauge.shadow_path);
+  }
+}
+
+static std::vector<std::string> find_missing_imports(const ElfFile &elf) {
+  std::vector<std::string> missing;
+  for (const auto &import: elf.GetImports()) {
+    if (import.weak || !GaugeLinker::IsEmulatorApi(import.name)) {
+      continue;
+    }
+    if (!dlsym(RTLD_DEFAULT, import.name.c_str())) {
+      missing.push_back(import.name);
+    }
+  }
+  std::ranges::sort(missing);
+  return missing;
+}
+
+std::expected<std::optional<GaugeLoader::PreparedGauge>, std::string> GaugeLoader::PrepareGauge(
+    const std::string &gauge_path, const std::string &gauge_name, std::optional<ShadowCopy::Result> shadow,
+    const uint64_t loaded_hash, const bool bind_now, PendingLoad *progress) {
+  if (gauge_name.size() > 200) {
+    return std::unexpected("Gauge name is too long: " + gauge_name);
+  }
+  ReloadStats stats{};
+  auto mark = std::chrono::steady_clock::now();
+  if (!shadow.has_value()) {
+    set_phase(progress, PendingLoad::Phase::Copying);
+    auto result = ShadowCopy::Create(gauge_path);
+    if (!result.has_value()) {
+      return std::unexpected(std::string("Failed to load gauge: ") + result.error());
+    }
+    shadow = result.value();
+    stats.copy = lap_ms(mark);
+  }
+  if (shadow->hash == loaded_hash) {
+    // Same path as the loaded copy, which keeps its own reference
+    ShadowCopy::Remove(shadow->path);
+    return std::nullopt;
   }
 
   std::cout << "Loading gauge " << gauge_path << std::endl;
+  set_phase(progress, PendingLoad::Phase::Parsing);
   auto json_path = FileDialog::GetJsonFilePath(gauge_path);
   if (!json_path.has_value()) {
-    dlclose(handle);
+    ShadowCopy::Remove(shadow->path);
     return std::unexpected(std::string("Failed to find JSON file for gauge: ") + gauge_name);
   }
   auto mount_params = ParseJson(json_path.value());
   if (!mount_params.has_value()) {
-    dlclose(handle);
+    ShadowCopy::Remove(shadow->path);
     return std::unexpected(std::string("Failed to parse JSON file for gauge: ") + json_path.value());
   }
+  stats.parse = lap_ms(mark);
 
-  auto gauge = Gauge{
-      handle,
-      (GaugeInitFunc) (dlsym(handle, std::string(gauge_name + "_gauge_init").c_str())),
-      (GaugeDrawFunc) (dlsym(handle, std::string(gauge_name + "_gauge_draw").c_str())),
-      (GaugeKillFunc) (dlsym(handle, std::string(gauge_name + "_gauge_kill").c_str())),
-      (GaugeUpdateFunc) (dlsym(handle, std::string(gauge_name + "_gauge_update").c_str())),
-      (GaugeMouseHandlerFunc) (dlsym(handle, std::string(gauge_name + "_gauge_mouse_handler").c_str())),
-      mount_params.value(),
-  };
+  // Loaded by its host process, which makes its own shadow copy; the hash still tells an unchanged rebuild apart
+  if (mount_params->isolation == GaugeIsolation::Process && !GaugeHost::IsHostProcess()) {
+    ShadowCopy::Remove(shadow->path);
+    set_phase(progress, PendingLoad::Phase::Initializing);
+    return PreparedGauge{Gauge{nullptr, GaugeHandle{}, mount_params.value(), "", shadow->hash}, GaugeCallbacks{}, {},
+                         stats};
+  }
 
+  // Checked before dlopen so no gauge code (static initializers included) runs for a gauge that can't work
+  set_phase(progress, PendingLoad::Phase::CheckingImports);
+  auto elf = ElfFile::Load(shadow->path);
+  if (!elf.has_value()) {
+    ShadowCopy::Remove(shadow->path);
+    return std::unexpected(std::string("Failed to load gauge: ") + elf.error());
+  }
+  auto missing_imports = find_missing_imports(elf.value());
+  if (!missing_imports.empty()) {
+    std::string list;
+    for (const auto &name: missing_imports) {
+      list += (list.empty() ? "" : ", ") + name;
+    }
+    if (bind_now) {
+      ShadowCopy::Remove(shadow->path);
+      return std::unexpected("Gauge " + gauge_name + " imports symbols the emulator does not provide: " + list);
+    }
+    std::cerr << "[Loader] " << gauge_name << " imports symbols the emulator does not provide, calling them will abort: "
+              << list << std::endl;
+  }
+  stats.check_imports = lap_ms(mark);
 
-  if (!gauge.init || !gauge.draw || !gauge.kill || !gauge.update || !gauge.mouse_handler) {
+  // Only "global" gauges see each other. The old version stays loaded until the new one is initialized, so with
+  // RTLD_GLOBAL the new copy's own data and function relocations bind to the old copy's definitions
+  set_phase(progress, PendingLoad::Phase::Opening);
+  if (mount_params->isolation == GaugeIsolation::Global) {
+    std::cerr << "[Loader] " << gauge_name << " uses global isolation, reloads may bind to the previous version"
+              << std::endl;
+  }
+  auto opened = GaugeLinker::Open(shadow->path, elf.value(), mount_params->isolation, bind_now);
+  if (!opened.has_value()) {
+    ShadowCopy::Remove(shadow->path);
+    return std::unexpected(std::string("Failed to load gauge: ") + opened.error());
+  }
+  void *handle = opened.value();
+  stats.open = lap_ms(mark);
+
+  set_phase(progress, PendingLoad::Phase::Resolving);
+  char symbol[256];
+  const auto resolve = [&](const char *suffix) -> void * {
+    std::snprintf(symbol, sizeof(symbol), "%s_%s", gauge_name.c_str(), suffix);
+    return dlsym(handle, symbol);
+  };
+  GaugeCallbacks callbacks{
+      reinterpret_cast<GaugeInitFunc>(resolve("gauge_init")),
+      reinterpret_cast<GaugeDrawFunc>(resolve("gauge_draw")),
+      reinterpret_cast<GaugeKillFunc>(resolve("gauge_kill")),
+      reinterpret_cast<GaugeUpdateFunc>(resolve("gauge_update")),
+      reinterpret_cast<GaugeMouseHandlerFunc>(resolve("gauge_mouse_handler")),
+      reinterpret_cast<GaugePreKillFunc>(resolve("gauge_pre_kill")),
+      reinterpret_cast<GaugeSaveStateFunc>(resolve("gauge_save_state")),
+  };
+  if (!callbacks.mouse_handler) {
+    callbacks.mouse_handler = reinterpret_cast<GaugeMouseHandlerFunc>(resolve("mouse_handler"));
+  }
+
+  if (!callbacks.init || !callbacks.draw) {
     dlclose(handle);
-    return std::unexpected(std::string("Failed to load gauge functions: ") + dlerror());
+    ShadowCopy::Remove(shadow->path);
+    return std::unexpected("Failed to load gauge functions: " + gauge_name + "_gauge_init and " + gauge_name +
+                           "_gauge_draw are required");
+  }
+  if (!callbacks.kill) {
+    std::cerr << "[Loader] " << gauge_name << " has no " << gauge_name << "_gauge_kill, its resources will leak"
+              << std::endl;
+  }
+  stats.resolve = lap_ms(mark);
+
+  set_phase(progress, PendingLoad::Phase::Initializing);
+  return PreparedGauge{Gauge{handle, GaugeHandle{}, mount_params.value(), shadow->path, shadow->hash}, callbacks,
+                       std::move(missing_imports), stats};
+}
+
+std::expected<GaugeLoader::Gauge, std::string> GaugeLoader::InstallGauge(const std::string &gauge_path,
+                                                                         const std::string &gauge_name,
+                                                                         const PreparedGauge &prepared) {
+  const auto handle = m_Dispatch.Allocate();
+  if (!handle.has_value()) {
+    discard_gauge(prepared.gauge);
+    return std::unexpected("Failed to load gauge: more than " + std::to_string(GaugeArena::CAPACITY) +
+                           " gauges loaded");
+  }
+
+  GaugeDispatch &dispatch = *m_Dispatch.Get(handle.value());
+  const GaugeCallbacks &callbacks = prepared.callbacks;
+  const auto &mount_params = prepared.gauge.mount_params;
+  dispatch.update = callbacks.update;
+  dispatch.draw = callbacks.draw;
+  dispatch.mouse_handler = callbacks.mouse_handler;
+  dispatch.ctx = base_ctx++;
+  dispatch.flags = (mount_params.parallel_update ? uint32_t{GaugeDispatch::PARALLEL_UPDATE} : 0u) |
+      (mount_params.always_redraw ? uint32_t{GaugeDispatch::ALWAYS_REDRAW} : 0u);
+  dispatch.init = callbacks.init;
+  dispatch.kill = callbacks.kill;
+  dispatch.pre_kill = callbacks.pre_kill;
+  dispatch.save_state = callbacks.save_state;
+
+  Gauge gauge = prepared.gauge;
+  gauge.dispatch = handle.value();
+
+  m_Renderers.emplace_back(gauge_name, gauge.dispatch, mount_params.width, mount_params.height);
+
+  double init_ms = 0.0;
+  if (!prepared.gauge.handle) {
+    const GaugeHost::Limits limits{mount_params.host_memory, mount_params.host_cpu_percent};
+    auto host = GaugeHost::Spawn(gauge_path, gauge_name, mount_params.width, mount_params.height, limits);
+    if (!host.has_value()) {
+      m_Renderers.pop_back();
+      m_Dispatch.Free(handle.value());
+      return std::unexpected("Failed to host gauge " + gauge_name + ": " + host.error());
+    }
+    m_Renderers.back().SetHost(host->get());
+    m_Hosts[gauge_name] = std::move(host.value());
+  } else {
+    auto reload_cache = ReloadCache::GetInstance();
+    auto heap_tracker = HeapTracker::GetInstance();
+    const auto [code_begin, code_end] = code_range(prepared.gauge.handle);
+    heap_tracker->Attach(dispatch.ctx, code_begin, code_end, mount_params.heap_limit);
+    if (mount_params.heap_arena || m_ArenaHeaps) {
+      if (mount_params.isolation == GaugeIsolation::Namespace) {
+        std::cerr << "[Heap] " << gauge_name << " allocates through its own libc in namespace isolation, no arena"
+                  << std::endl;
+      } else if (auto arena = heap_tracker->CreateArena(dispatch.ctx); !arena.has_value()) {
+        std::cerr << "[Heap] No arena for " << gauge_name << ": " << arena.error() << std::endl;
+      }
+    }
+    reload_cache->BeginRestore(dispatch.ctx, gauge_name);
+    auto mark = std::chrono::steady_clock::now();
+    bool initialized;
+    {
+      CallbackScope scope(dispatch.ctx, nullptr, false);
+      initialized = FaultGuard::Run(dispatch.ctx, FaultGuard::Callback::Init,
+                                    [&dispatch] { dispatch.init(dispatch.ctx, nullptr); });
+    }
+    init_ms = lap_ms(mark);
+    reload_cache->EndRestore(dispatch.ctx);
+    // Stays loaded but inert, so its watcher is running and the fixed build reloads over it
+    if (!initialized) {
+      ProcessFaults();
+    }
+  }
+
+  // The unload half stays, a reload reports both
+  const ReloadStats &loaded = prepared.stats;
+  m_ReloadStats.copy = loaded.copy;
+  m_ReloadStats.parse = loaded.parse;
+  m_ReloadStats.check_imports = loaded.check_imports;
+  m_ReloadStats.open = loaded.open;
+  m_ReloadStats.resolve = loaded.resolve;
+  m_ReloadStats.init = init_ms;
+
+  std::cout << "GaugeLoader::LoadGauge: " << gauge_name << " ctx " << dispatch.ctx << std::endl;
+
+  if (m_WatchFiles && !m_Watchers.contains(gauge_name)) {
+    auto stop = std::make_shared<std::atomic<bool>>(false);
+    m_Watchers.emplace(gauge_name, stop);
+    start_gauge_watcher(gauge_path, gauge_name, stop);
+  }
+
+  return gauge;
+}
+
+std::expected<GaugeLoader::Gauge, std::string> GaugeLoader::LoadGauge(const std::string &gauge_path,
+                                                                      const std::string &gauge_name) {
+  auto prepared = PrepareGauge(gauge_path, gauge_name, std::nullopt, 0, m_EagerBinding, nullptr);
+  if (!prepared.has_value()) {
+    return std::unexpected(prepared.error());
+  }
+  auto gauge = InstallGauge(gauge_path, gauge_name, prepared->value());
+  if (gauge.has_value()) {
+    m_MissingImports[gauge_name] = std::move(prepared->value().missing_imports);
+  }
+  return gauge;
+}
+
+void GaugeLoader::RequestLoad(const std::string &gauge_path, const std::string &gauge_name,
+                              std::optional<ShadowCopy::Result> shadow) {
+  // Only the newest request for a gauge gets installed
+  for (const auto &pending: m_PendingLoads) {
+    if (pending->gauge_name == gauge_name) {
+      pending->cancelled = true;
+    }
+  }
+
+  auto pending = std::make_shared<PendingLoad>();
+  pending->gauge_name = gauge_name;
+  pending->gauge_path = gauge_path;
+  pending->started = std::chrono::steady_clock::now();
+  m_PendingLoads.push_back(pending);
+
+  uint64_t loaded_hash = 0;
+  if (const auto it = m_Gauges.find(gauge_name); it != m_Gauges.end()) {
+    loaded_hash = it->second.image_hash;
+  }
+
+  std::thread([pending, shadow, loaded_hash, bind_now = m_EagerBinding]() {
+    auto result = PrepareGauge(pending->gauge_path, pending->gauge_name, shadow, loaded_hash, bind_now, pending.get());
+    Application::Get().value()->QueueEvent([pending, result = std::move(result)]() mutable {
+      GaugeLoader::GetInstance()->FinishLoad(pending, std::move(result));
+    });
+  }).detach();
+}
+
+void GaugeLoader::FinishLoad(const std::shared_ptr<PendingLoad> &pending,
+                             std::expected<std::optional<PreparedGauge>, std::string> result) {
+  std::erase(m_PendingLoads, pending);
+
+  if (!result.has_value()) {
+    std::cerr << "Error loading gauge: " << result.error() << std::endl;
+    m_LastLoadError = result.error();
+    return;
+  }
+  if (!result->has_value()) {
+    std::cout << "Skipping reload of " << pending->gauge_name << ", contents unchanged" << std::endl;
+    return;
+  }
+  if (pending->cancelled) {
+    discard_gauge(result->value().gauge);
+    return;
+  }
+
+  // The previous version rendered right up to this point, the swap happens within a single frame
+  const auto init_start = std::chrono::steady_clock::now();
+  if (m_Gauges.contains(pending->gauge_name)) {
+    if (auto unloaded = UnloadGauge(pending->gauge_name, true); !unloaded.has_value()) {
+      std::cerr << "Error unloading gauge: " << unloaded.error() << std::endl;
+    }
+  }
+  auto gauge = InstallGauge(pending->gauge_path, pending->gauge_name, result->value());
+  if (!gauge.has_value()) {
+    std::cerr << "Error loading gauge: " << gauge.error() << std::endl;
+    m_LastLoadError = gauge.error();
+    return;
+  }
+  m_Gauges[pending->gauge_name] = gauge.value();
+  m_MissingImports[pending->gauge_name] = std::move(result->value().missing_imports);
+  m_LastLoadError.clear();
+
+  const auto now = std::chrono::steady_clock::now();
+  std::cout << "Loaded " << pending->gauge_name << " in "
+            << std::chrono::duration<double, std::milli>(now - pending->started).count() << " ms (swap + init "
+            << std::chrono::duration<double, std::milli>(now - init_start).count() << " ms)" << std::endl;
+}
+
+bool GaugeLoader::WantsContinuousRedraw() const {
+  const bool always_redraw = std::ranges::any_of(m_Dispatch.GetLive(), [this](const uint32_t index) {
+    return (m_Dispatch.GetSlot(index).flags & (GaugeDispatch::ALWAYS_REDRAW | GaugeDispatch::FAULTED)) ==
+        GaugeDispatch::ALWAYS_REDRAW;
+  });
+  // A hosted gauge draws in its child whenever it likes, only polling notices new frames and simvar writes
+  return always_redraw || std::ranges::any_of(m_Hosts, [this](const auto &entry) {
+           const auto gauge = m_Gauges.find(entry.first);
+           const GaugeDispatch *dispatch = gauge != m_Gauges.end() ? m_Dispatch.Get(gauge->second.dispatch) : nullptr;
+           return dispatch && !(dispatch->flags & GaugeDispatch::FAULTED);
+         });
+}
+
+std::string GaugeLoader::GetGaugeName(const unsigned long long ctx) const {
+  if (ctx == 0) {
+    return "(emulator)";
+  }
+  // Renderers exist from before init until the unload, names of gauges still initializing included
+  for (const auto &renderer: m_Renderers) {
+    const GaugeDispatch *dispatch = m_Dispatch.Get(renderer.GetGauge());
+    if (dispatch && dispatch->ctx == ctx) {
+      return renderer.GetTitle();
+    }
+  }
+  return "ctx " + std::to_string(ctx) + " (unloaded)";
+}
+
+void GaugeLoader::ProcessFaults() {
+  for (const auto &fault: FaultGuard::TakeFaults()) {
+    for (const auto &renderer: m_Renderers) {
+      GaugeDispatch *dispatch = m_Dispatch.Get(renderer.GetGauge());
+      if (dispatch && dispatch->ctx == fault.ctx) {
+        dispatch->flags |= GaugeDispatch::FAULTED;
+        break;
+      }
+    }
+    const std::string gauge_name = GetGaugeName(fault.ctx);
+
+    char address[32];
+    std::snprintf(address, sizeof(address), "0x%llx", static_cast<unsigned long long>(fault.address));
+    const std::string summary = FaultGuard::Describe(fault.signal, fault.code) + " at " + address + " in " +
+        FaultGuard::CallbackName(fault.callback);
+    std::cerr << "[Fault] " << gauge_name << (fault.signal == FaultGuard::HANG ? " hung: " : " crashed: ") << summary
+              << ", its callbacks are suspended until it is reloaded" << std::endl;
+    auto profiler = SamplingProfiler::GetInstance();
+    for (int i = 0; i < fault.depth; i++) {
+      // Outer frames hold return addresses, step back into the call instruction
+      const auto pc = reinterpret_cast<uintptr_t>(fault.frames[i]) - (i > 0 ? 1 : 0);
+      std::cerr << "  #" << i << " " << profiler->Symbolize(pc) << std::endl;
+    }
+    m_Faults[gauge_name] = summary;
+    Application::RequestRedraw();
+  }
+}
+
+int GaugeLoader::AddVariable(const std::string &name, const double value) {
+  const bool parallel = m_ParallelUpdates.load(std::memory_order_relaxed);
+  std::unique_lock lock(m_VariablesMutex, std::defer_lock);
+  if (parallel) {
+    lock.lock();
+  }
+  if (const auto it = m_VariableIds.find(name); it != m_VariableIds.end()) {
+    return it->second;
+  }
+
+  const int id = static_cast<int>(m_Variables.size());
+  m_Variables.emplace_back(name, value);
+  m_VariableVersions.push_back(0);
+  m_VariableIds.emplace(name, id);
+  m_VariableIndex.Add(id, name);
+  if (parallel) {
+    m_RegisteredDuringUpdate.push_back(id);
+  } else {
+    RecordChange(id);
+  }
+  return id;
+}
+
+void GaugeLoader::RemoveVariable(const std::string &name) {
+  const bool parallel = m_ParallelUpdates.load(std::memory_order_relaxed);
+  std::unique_lock lock(m_VariablesMutex, std::defer_lock);
+  if (parallel) {
+    lock.lock();
+  }
+  const auto it = m_VariableIds.find(name);
+  if (it == m_VariableIds.end()) {
+    return;
+  }
+  const int id = it->second;
+  m_VariableIds.erase(it);
+  m_VariableIndex.Remove(id);
+  m_Variables[id] = {std::string(), 0.0};
+  if (parallel) {
+    m_RegisteredDuringUpdate.push_back(id);
+  } else {
+    RecordChange(id);
+  }
+}
+
+double GaugeLoader::GetVariable(const std::string &name) {
+  const auto lock = LockVariablesShared();
+  if (const auto it = m_VariableIds.find(name); it != m_VariableIds.end()) {
+    return m_Variables[it->second].second;
+  }
+  return 0;
+}
+
+void GaugeLoader::UpdateVariable(const int id, double value) {
+  if (s_DeferredWrites) {
+    s_DeferredWrites->emplace_back(id, value);
+    return;
+  }
+  auto &variable = m_Variables[id].second;
+  if (variable == value) {
+    return;
+  }
+  variable = value;
+  RecordChange(id);
+  Application::RequestRedraw();
+}
+
+void GaugeLoader::RecordChange(const int id) {
+  // Publish the epoch last so a reader that sees it also sees the version and log entry
+  const uint64_t epoch = m_VariableEpoch.load(std::memory_order_relaxed) + 1;
+  m_VariableVersions[id] = epoch;
+  const double value = m_Variables[id].second;
+  m_ChangeLog[epoch % CHANGE_LOG_SIZE] = VariableChange{epoch, id, value};
+  m_VariableEpoch.store(epoch, std::memory_order_release);
+  for (const auto &subscription: m_Subscriptions) {
+    if (subscription.variable == id || subscription.variable == -1) {
+      subscription.callback(id, value);
+    }
+  }
+}
+
+bool GaugeLoader::GetChangesSince(const uint64_t epoch, std::vector<VariableChange> &out) const {
+  const uint64_t latest = GetVariableEpoch();
+  if (epoch >= latest) {
+    return true;
+  }
+  // Every epoch has exactly one log entry, so the log covers the last CHANGE_LOG_SIZE epochs
+  const bool complete = latest - epoch <= CHANGE_LOG_SIZE;
+  const uint64_t first = complete ? epoch + 1 : latest - CHANGE_LOG_SIZE + 1;
+  for (uint64_t current = first; current <= latest; ++current) {
+    out.push_back(m_ChangeLog[current % CHANGE_LOG_SIZE]);
   }
+  return complete;
+}
 
-  InstrumentRenderer renderer(gauge_name, base_ctx, gauge);
+uint64_t GaugeLoader::Subscribe(const int id, VariableCallback callback) {
+  const uint64_t subscription = m_NextSubscription++;
+  m_Subscriptions.push_back(Subscription{subscription, id, std::move(callback)});
+  return subscription;
+}
 
-  m_Renderers.push_back(renderer);
+void GaugeLoader::Unsubscribe(const uint64_t subscription) {
+  std::erase_if(m_Subscriptions, [subscription](const Subscription &entry) { return entry.id == subscription; });
+}
 
-  gauge.init(base_ctx, nullptr);
+void GaugeLoader::InvalidateGauge(const unsigned long long ctx) {
+  for (const uint32_t index: m_Dispatch.GetLive()) {
+    GaugeDispatch &dispatch = m_Dispatch.GetSlot(index);
+    if (dispatch.ctx == ctx) {
+      dispatch.reads.stale = true;
+      return;
+    }
+  }
+}
 
-  std::cout << "GaugeLoader::LoadGauge: " << gauge.init << std::endl;
+void GaugeLoader::UpdateGauges(float dTime) {
+  const auto start = std::chrono::steady_clock::now();
 
-  std::pair<unsigned long long, Gauge> ret = std::make_pair(base_ctx, gauge);
-  base_ctx++;
+  // Simvars written by hosted gauges last frame arrive before anything in here reads them
+  for (const auto &[gauge_name, host]: m_Hosts) {
+    const auto error = host->Poll(*this);
+    if (!error.has_value()) {
+      continue;
+    }
+    if (GaugeDispatch *dispatch = m_Dispatch.Get(m_Gauges.at(gauge_name).dispatch)) {
+      dispatch->flags |= GaugeDispatch::FAULTED;
+    }
+    std::cerr << "[Host] " << gauge_name << " (process " << host->GetPid() << ") stopped: " << error.value()
+              << ", showing its last frame until it is reloaded" << std::endl;
+    m_Faults[gauge_name] = error.value();
+    Application::RequestRedraw();
+  }
 
-  start_gauge_watcher(gauge_path, gauge_name);
+  // The dispatch entries double as pool jobs, the arena never moves them
+  size_t parallel_jobs = 0;
+  if (!m_ForceSerialUpdate) {
+    for (const uint32_t index: m_Dispatch.GetLive()) {
+      GaugeDispatch &dispatch = m_Dispatch.GetSlot(index);
+      if (!dispatch.update || (dispatch.flags & (GaugeDispatch::PARALLEL_UPDATE | GaugeDispatch::FAULTED)) !=
+              GaugeDispatch::PARALLEL_UPDATE) {
+        continue;
+      }
+      if (!m_UpdatePool) {
+        const unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+        m_UpdatePool = std::make_unique<WorkerPool>(cores - 1);
+      }
+      // Before the first job can run, the pool's queue publishes it to the workers
+      m_ParallelUpdates.store(true, std::memory_order_relaxed);
+      dispatch.update_dtime = dTime;
+      m_UpdatePool->Submit(WorkerPool::Task{&GaugeLoader::RunUpdateJob, &dispatch});
+      parallel_jobs++;
+    }
+  }
 
-  return ret;
+  // Serial gauges run on the main thread while the pool chews through the parallel ones
+  for (const uint32_t index: m_Dispatch.GetLive()) {
+    GaugeDispatch &dispatch = m_Dispatch.GetSlot(index);
+    if (!dispatch.update || (dispatch.flags & GaugeDispatch::FAULTED)) {
+      continue;
+    }
+    if ((dispatch.flags & GaugeDispatch::PARALLEL_UPDATE) && !m_ForceSerialUpdate) {
+      continue;
+    }
+    // Workers read the variables meanwhile, so nobody writes them until the barrier
+    if (parallel_jobs > 0) {
+      s_DeferredWrites = &dispatch.writes;
+    }
+    {
+      CallbackScope scope(dispatch.ctx, &dispatch.reads, false);
+      PerfCounters::Measurement measurement(dispatch.ctx, PerfCounters::Callback::Update);
+      FaultGuard::Run(dispatch.ctx, FaultGuard::Callback::Update,
+                      [&dispatch, dTime] { dispatch.update(dispatch.ctx, dTime); });
+    }
+    s_DeferredWrites = nullptr;
+  }
+
+  // Barrier: nothing may draw until every update has finished
+  if (parallel_jobs > 0) {
+    m_UpdatePool->Wait();
+    m_ParallelUpdates.store(false, std::memory_order_relaxed);
+    for (const int id: m_RegisteredDuringUpdate) {
+      RecordChange(id);
+    }
+    m_RegisteredDuringUpdate.clear();
+    // In load order, when two gauges set the same simvar the one loaded last wins, every frame alike
+    for (const uint32_t index: m_Dispatch.GetLive()) {
+      GaugeDispatch &dispatch = m_Dispatch.GetSlot(index);
+      for (const auto &[id, value]: dispatch.writes) {
+        UpdateVariable(id, value);
+      }
+      dispatch.writes.clear();
+    }
+  }
+  // Serial and pool updates alike, a gauge that crashed in update doesn't get to draw
+  ProcessFaults();
+
+  m_LastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-std::pair<unsigned long long, GaugeLoader::Gauge> GaugeLoader::GetOrLoadGauge(const std::string &gauge_path,
-                                                                              const std::string &gauge_name) {
-  if (m_Gauges.contains(gauge_name)) {
-    return GetFromMap(gauge_name);
+GaugeHandle GaugeLoader::GetOrLoadGauge(const std::string &gauge_path, const std::string &gauge_name) {
+  if (const auto it = m_Gauges.find(gauge_name); it != m_Gauges.end()) {
+    return it->second.dispatch;
   }
   auto gauge_result = LoadGauge(gauge_path, gauge_name);
   if (!gauge_result) {
     throw std::runtime_error(gauge_result.error());
   }
   m_Gauges[gauge_name] = gauge_result.value();
-  return m_Gauges[gauge_name];
-}
-
-std::pair<unsigned long long, GaugeLoader::Gauge> GaugeLoader::GetFromMap(const std::string &gauge_name) const {
-  return m_Gauges.at(gauge_name);
+  return gauge_result->dispatch;
 }
 
-std::expected<void, std::string> GaugeLoader::UnloadGauge(const std::string &gauge_name) {
-  // std::cout << "Unloading gauge: " << gauge_name << std::endl;
-  if (m_Gauges.empty()) {
+std::expected<void, std::string> GaugeLoader::UnloadGauge(const std::string &gauge_name, bool keep_state) {
+  const auto it = m_Gauges.find(gauge_name);
+  if (it == m_Gauges.end()) {
     return std::unexpected(std::string("Gauge is already unloaded: ") + gauge_name);
   }
-  const auto gauge = m_Gauges.at("MFD");
+  const Gauge gauge = it->second;
+  const GaugeDispatch *dispatch = m_Dispatch.Get(gauge.dispatch);
+  const unsigned long long ctx = dispatch ? dispatch->ctx : 0;
+  // Its state can't be trusted and kill may well crash the same way, only dlclose is left
+  const bool faulted = dispatch && (dispatch->flags & GaugeDispatch::FAULTED);
+  if (faulted) {
+    std::cerr << "[Fault] Skipping save_state and kill of " << gauge_name << ", whatever it held is leaked"
+              << std::endl;
+  }
+
+  auto reload_cache = ReloadCache::GetInstance();
+  auto mark = std::chrono::steady_clock::now();
+  if (keep_state && dispatch && dispatch->save_state && !faulted) {
+    sEmulatorStateBuffer buffer;
+    bool saved = false;
+    FaultGuard::Run(ctx, FaultGuard::Callback::SaveState,
+                    [&] { saved = dispatch->save_state(dispatch->ctx, &buffer); });
+    if (saved) {
+      std::cout << "Saved " << buffer.data.size() << " bytes of state for " << gauge_name << std::endl;
+      reload_cache->StoreState(gauge_name, std::move(buffer));
+    } else {
+      reload_cache->DropState(gauge_name);
+    }
+  } else {
+    reload_cache->DropState(gauge_name);
+  }
+  m_ReloadStats.save_state = lap_ms(mark);
+
+  if (dispatch && !faulted) {
+    FaultGuard::Run(ctx, FaultGuard::Callback::Kill, [dispatch] {
+      if (dispatch->pre_kill) {
+        dispatch->pre_kill(dispatch->ctx);
+      }
+      if (dispatch->kill) {
+        dispatch->kill(dispatch->ctx);
+      }
+    });
+  }
+  m_ReloadStats.kill = lap_ms(mark);
+  // Reported before the name goes away with the renderer
+  ProcessFaults();
+  // Pending samples still point into this library
+  SamplingProfiler::GetInstance()->OnGaugeUnloaded();
+  m_Dispatch.Free(gauge.dispatch);
+  m_Gauges.erase(it);
+  std::erase_if(m_Renderers, [&gauge_name](const InstrumentRenderer &renderer) {
+    return renderer.GetTitle() == gauge_name;
+  });
+  // Its renderer is gone, the child is told to stop and reaped in the background
+  m_Hosts.erase(gauge_name);
+  mark = std::chrono::steady_clock::now();
+  discard_gauge(gauge);
+  m_ReloadStats.close = lap_ms(mark);
+  // After dlclose, static destructors may still free into the gauge's arena
+  const auto leak = HeapTracker::GetInstance()->Detach(ctx);
+  m_ReloadStats.leaked_bytes = leak.bytes;
+  m_ReloadStats.leaked_blocks = leak.blocks;
+  if (leak.blocks > 0) {
+    std::cerr << "[Heap] " << gauge_name << " still held " << leak.bytes << " bytes in " << leak.blocks
+              << " blocks after unloading" << (leak.arena_bytes > 0 ? ", dropped with its arena" : "") << std::endl;
+  }
+  if (leak.arena_bytes > 0) {
+    std::cout << "[Heap] Released " << leak.arena_bytes / 1024 << " KiB arena of " << gauge_name << std::endl;
+  }
 
-  if (gauge.second.kill) {
-    gauge.second.kill(gauge.first);
+  m_Faults.erase(gauge_name);
+  if (!keep_state) {
+    m_MissingImports.erase(gauge_name);
+    if (const auto watcher = m_Watchers.find(gauge_name); watcher != m_Watchers.end()) {
+      *watcher->second = true;
+      m_Watchers.erase(watcher);
+    }
   }
-  m_Gauges.clear();
-  m_Renderers.clear();
-  dlclose(gauge.second.handle);
 
   return {};
 }
 
 std::expected<void, std::string> GaugeLoader::UnloadAllGauges() {
-  for (const auto &gauge: m_Gauges) {
-    if (auto result = UnloadGauge("MFD"); !result.has_value()) {
+  for (const auto &pending: m_PendingLoads) {
+    pending->cancelled = true;
+  }
+  std::vector<std::string> names;
+  names.reserve(m_Gauges.size());
+  for (const auto &name: m_Gauges | std::views::keys) {
+    names.push_back(name);
+  }
+  for (const auto &name: names) {
+    if (auto result = UnloadGauge(name); !result.has_value()) {
       return std::unexpected(result.error());
     }
   }
-  m_Gauges.clear();
   return {};
 }
 
+InstrumentRenderer::~InstrumentRenderer() { DeleteFramebuffer(); }
+
+InstrumentRenderer::InstrumentRenderer(InstrumentRenderer &&other) noexcept
+    : m_Title(std::move(other.m_Title))
+    , m_Gauge(other.m_Gauge)
+    , m_Width(other.m_Width)
+    , m_Height(other.m_Height)
+    , m_Position(other.m_Position)
+    , m_Size(other.m_Size)
+    , m_LastMouse(other.m_LastMouse)
+    , m_Hovered(other.m_Hovered)
+    , m_InputPending(other.m_InputPending)
+    , m_Framebuffer(std::exchange(other.m_Framebuffer, 0))
+    , m_ColorTexture(std::exchange(other.m_ColorTexture, 0))
+    , m_StencilBuffer(std::exchange(other.m_StencilBuffer, 0))
+    , m_FramebufferWidth(std::exchange(other.m_FramebufferWidth, 0))
+    , m_FramebufferHeight(std::exchange(other.m_FramebufferHeight, 0))
+    , m_Host(other.m_Host) {}
+
+InstrumentRenderer &InstrumentRenderer::operator=(InstrumentRenderer &&other) noexcept {
+  if (this != &other) {
+    DeleteFramebuffer();
+    m_Title = std::move(other.m_Title);
+    m_Gauge = other.m_Gauge;
+    m_Width = other.m_Width;
+    m_Height = other.m_Height;
+    m_Position = other.m_Position;
+    m_Size = other.m_Size;
+    m_LastMouse = other.m_LastMouse;
+    m_Hovered = other.m_Hovered;
+    m_InputPending = other.m_InputPending;
+    m_Framebuffer = std::exchange(other.m_Framebuffer, 0);
+    m_ColorTexture = std::exchange(other.m_ColorTexture, 0);
+    m_StencilBuffer = std::exchange(other.m_StencilBuffer, 0);
+    m_FramebufferWidth = std::exchange(other.m_FramebufferWidth, 0);
+    m_FramebufferHeight = std::exchange(other.m_FramebufferHeight, 0);
+    m_Host = other.m_Host;
+  }
+  return *this;
+}
+
+void InstrumentRenderer::DeleteFramebuffer() {
+  if (m_Framebuffer) glDeleteFramebuffers(1, &m_Framebuffer);
+  if (m_ColorTexture) glDeleteTextures(1, &m_ColorTexture);
+  if (m_StencilBuffer) glDeleteRenderbuffers(1, &m_StencilBuffer);
+  m_Framebuffer = m_ColorTexture = m_StencilBuffer = 0;
+  m_FramebufferWidth = m_FramebufferHeight = 0;
+}
+
+bool InstrumentRenderer::ResizeFramebuffer(const int width, const int height) {
+  DeleteFramebuffer();
+
+  GLint last_texture, last_renderbuffer, last_framebuffer;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+  glGetIntegerv(GL_RENDERBUFFER_BINDING, &last_renderbuffer);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+
+  glGenTextures(1, &m_ColorTexture);
+  glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenRenderbuffers(1, &m_StencilBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_StencilBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+  glGenFramebuffers(1, &m_Framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_StencilBuffer);
+  const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+  glBindTexture(GL_TEXTURE_2D, last_texture);
+  glBindRenderbuffer(GL_RENDERBUFFER, last_renderbuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer);
+
+  if (!complete) {
+    std::cerr << "[Renderer] Framebuffer for " << m_Title << " is incomplete" << std::endl;
+    DeleteFramebuffer();
+    return false;
+  }
+  m_FramebufferWidth = width;
+  m_FramebufferHeight = height;
+  return true;
+}
+
+// A draw that crashed left NanoVG's bindings behind, put back what the next gauge and ImGui's renderer expect
+static void reset_gl_state() {
+  glUseProgram(0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glDisable(GL_STENCIL_TEST);
+  glStencilMask(0xffffffff);
+  glStencilFunc(GL_ALWAYS, 0, 0xffffffff);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  // Errors of the interrupted calls, bounded because a lost context reports one forever
+  for (int i = 0; i < 16 && glGetError() != GL_NO_ERROR; i++) {
+  }
+}
+
+ImVec2 InstrumentRenderer::GetHostMousePosition() const {
+  const ImVec2 mouse = ImGui::GetMousePos();
+  const float scale_x = m_Size.x > 0.0f ? static_cast<float>(m_Width) / m_Size.x : 1.0f;
+  const float scale_y = m_Size.y > 0.0f ? static_cast<float>(m_Height) / m_Size.y : 1.0f;
+  return ImVec2((mouse.x - m_Position.x) * scale_x, (mouse.y - m_Position.y) * scale_y);
+}
+
 void InstrumentRenderer::RenderContents() {
-  int display_w, display_h;
-  glfwGetFramebufferSize(Application::Get().value()->GetHandle(), &display_w, &display_h);
-  glViewport(0, 0, display_w, display_h);
+  auto loader = GaugeLoader::GetInstance();
+  GaugeDispatch *dispatch = loader->GetDispatch(m_Gauge);
+  // A faulted gauge keeps showing its last image
+  if (!dispatch || (dispatch->flags & GaugeDispatch::FAULTED)) {
+    return;
+  }
+  // The child draws at the json size whatever the window's, the texture only receives its frames
+  if (m_Host) {
+    if ((m_FramebufferWidth != m_Width || m_FramebufferHeight != m_Height) && !ResizeFramebuffer(m_Width, m_Height)) {
+      return;
+    }
+    const ImVec2 mouse = GetHostMousePosition();
+    m_Host->SetMousePosition(mouse.x, mouse.y);
+    m_Host->UploadFrame(m_ColorTexture);
+    return;
+  }
+
+  const int fbWidth = static_cast<int>(m_Size.x);
+  const int fbHeight = static_cast<int>(m_Size.y);
+  if (fbWidth <= 0 || fbHeight <= 0) {
+    return;
+  }
+  if (fbWidth != m_FramebufferWidth || fbHeight != m_FramebufferHeight) {
+    if (!ResizeFramebuffer(fbWidth, fbHeight)) {
+      return;
+    }
+    dispatch->reads.stale = true;
+  }
 
-  int fbWidth = static_cast<int>(m_Size.x);
-  int fbHeight = static_cast<int>(m_Size.y);
-  if (fbWidth > 0 && fbHeight > 0) {
-    GLint last_viewport[4];
-    glGetIntegerv(GL_VIEWPORT, last_viewport);
-    GLboolean last_scissor_test;
-    glGetBooleanv(GL_SCISSOR_TEST, &last_scissor_test);
+  const auto &versions = loader->GetVariableVersions();
+  const uint64_t epoch = loader->GetVariableEpoch();
+  const bool needs_draw = !loader->IsSkipUnchangedDraws() || m_InputPending ||
+      (dispatch->flags & GaugeDispatch::ALWAYS_REDRAW) || dispatch->reads.NeedsDraw(versions, epoch);
+  if (!needs_draw) {
+    loader->GetDrawStats().skipped++;
+    return;
+  }
+  m_InputPending = false;
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_SCISSOR_TEST);
+  GLint last_framebuffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+  GLint last_viewport[4];
+  glGetIntegerv(GL_VIEWPORT, last_viewport);
+  GLboolean last_scissor_test;
+  glGetBooleanv(GL_SCISSOR_TEST, &last_scissor_test);
 
-    glViewport(m_Position.x, display_h - m_Position.y - fbHeight, fbWidth, fbHeight);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+  glViewport(0, 0, fbWidth, fbHeight);
+  glDisable(GL_SCISSOR_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClearStencil(0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    sGaugeDrawData gaugeData{ImGui::GetMousePos().x - m_Position.x,
-                             ImGui::GetMousePos().y - m_Position.y,
-                             static_cast<double>(glfwGetTime()),
-                             0.0f,  // TODO: calculate delta time
-                             static_cast<int>(m_Size.x),
-                             static_cast<int>(m_Size.y),
-                             static_cast<int>(m_Size.x),
-                             static_cast<int>(m_Size.y)};
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glEnable(GL_CULL_FACE);
+  glDisable(GL_DEPTH_TEST);
 
-    m_gauge.draw(m_GaugeCtx, &gaugeData);
+  sGaugeDrawData gaugeData{ImGui::GetMousePos().x - m_Position.x,
+                           ImGui::GetMousePos().y - m_Position.y,
+                           static_cast<double>(glfwGetTime()),
+                           0.0f,  // TODO: calculate delta time
+                           fbWidth,
+                           fbHeight,
+                           fbWidth,
+                           fbHeight};
 
-    glViewport(last_viewport[0], last_viewport[1], last_viewport[2], last_viewport[3]);
-    if (last_scissor_test) glEnable(GL_SCISSOR_TEST);
+  bool drawn;
+  {
+    CallbackScope scope(dispatch->ctx, &dispatch->reads, true);
+    PerfCounters::Measurement measurement(dispatch->ctx, PerfCounters::Callback::Draw);
+    drawn = FaultGuard::Run(dispatch->ctx, FaultGuard::Callback::Draw,
+                            [dispatch, &gaugeData] { dispatch->draw(dispatch->ctx, &gaugeData); });
   }
+  if (drawn) {
+    dispatch->reads.MarkDrawn(versions, epoch);
+    loader->GetDrawStats().drawn++;
+  } else {
+    reset_gl_state();
+    loader->ProcessFaults();
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer);
+  glViewport(last_viewport[0], last_viewport[1], last_viewport[2], last_viewport[3]);
+  if (last_scissor_test) glEnable(GL_SCISSOR_TEST);
+}
+
+void InstrumentRenderer::RenderOffscreen(const bool force) {
+  m_Size = ImVec2(static_cast<float>(m_Width), static_cast<float>(m_Height));
+  m_InputPending |= force;
+  RenderContents();
 }
 
 void InstrumentRenderer::CreateImGuiWindow() {
   ImGui::SetNextWindowSize(
-      {static_cast<float>(m_gauge.mount_params.width), static_cast<float>(m_gauge.mount_params.height)});
-  std::string title =
-      m_Title + " " + std::to_string(m_gauge.mount_params.width) + "x" + std::to_string(m_gauge.mount_params.height);
+      {static_cast<float>(m_Width), static_cast<float>(m_Height)});
+  std::string title = m_Title + " " + std::to_string(m_Width) + "x" + std::to_string(m_Height);
   ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
 
   ImGui::Begin(title.c_str(), nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
@@ -208,13 +1060,42 @@ void InstrumentRenderer::CreateImGuiWindow() {
   m_Position = position;
   m_Size = size;
 
+  // GL framebuffers are bottom up, flip the image. RenderContents fills it later this frame, before ImGui draws.
+  if (m_ColorTexture) {
+    ImGui::Image((ImTextureID)(intptr_t)m_ColorTexture, m_Size, ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+    ImGui::SetCursorScreenPos(position);
+  }
+
   if (ImGui::InvisibleButton("canvas", m_Size)) {
-    float mouse_x_pos, mouse_y_pos;
-    mouse_x_pos = ImGui::GetMousePos().x - m_Position.x;
-    mouse_y_pos = ImGui::GetMousePos().y - m_Position.y;
-    m_gauge.mouse_handler(m_GaugeCtx, mouse_x_pos, mouse_y_pos,
-                          0);  // TODO: handle mouse flags
+    m_InputPending = true;
+    GaugeDispatch *dispatch = GaugeLoader::GetInstance()->GetDispatch(m_Gauge);
+    if (m_Host) {
+      if (dispatch && !(dispatch->flags & GaugeDispatch::FAULTED)) {
+        const ImVec2 mouse = GetHostMousePosition();
+        m_Host->PushClick(mouse.x, mouse.y, 0);
+      }
+    } else if (dispatch && dispatch->mouse_handler && !(dispatch->flags & GaugeDispatch::FAULTED)) {
+      float mouse_x_pos, mouse_y_pos;
+      mouse_x_pos = ImGui::GetMousePos().x - m_Position.x;
+      mouse_y_pos = ImGui::GetMousePos().y - m_Position.y;
+      CallbackScope scope(dispatch->ctx, &dispatch->reads, false);
+      const bool handled = FaultGuard::Run(dispatch->ctx, FaultGuard::Callback::Mouse, [&] {
+        dispatch->mouse_handler(dispatch->ctx, mouse_x_pos, mouse_y_pos, 0);  // TODO: handle mouse flags
+      });
+      if (!handled) {
+        GaugeLoader::GetInstance()->ProcessFaults();
+      }
+    }
+  }
+
+  // Hover effects follow the cursor, and need one more draw once it leaves
+  const bool hovered = ImGui::IsItemHovered();
+  const ImVec2 mouse = ImGui::GetMousePos();
+  if (hovered != m_Hovered || (hovered && (mouse.x != m_LastMouse.x || mouse.y != m_LastMouse.y))) {
+    m_InputPending = true;
   }
+  m_Hovered = hovered;
+  m_LastMouse = mouse;
 
   ImGui::End();
   ImGui::PopStyleColor();
@@ -1,41 +1,56 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <expected>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "FsShims/FsStructs.hpp"
+#include "GaugeLoader/FaultGuard.hpp"
+#include "GaugeLoader/GaugeDispatch.hpp"
+#include "GaugeLoader/GaugeHost.hpp"
+#include "GaugeLoader/GaugeLinker.hpp"
+#include "GaugeLoader/ReloadCache.hpp"
+#include "GaugeLoader/ShadowCopy.hpp"
+#include "Profiling/PerfCounters.hpp"
+#include "Profiling/SimVarProfiler.hpp"
+#include "Search/TrigramIndex.hpp"
+#include "Threading/WorkerPool.hpp"
 #include "imgui.h"
 #include "nlohmann/json.hpp"
 
-typedef bool (*GaugeInitFunc)(unsigned long long ctx, sGaugeInstallData *install_data);
-typedef bool (*GaugeDrawFunc)(unsigned long long ctx, sGaugeDrawData *draw_data);
-typedef bool (*GaugeKillFunc)(unsigned long long ctx);
-typedef bool (*GaugeUpdateFunc)(unsigned long long ctx, float dTime);
-typedef void (*GaugeMouseHandlerFunc)(unsigned long long ctx, float fX, float fY, int iFlags);
-
 class InstrumentRenderer;
 
 class GaugeLoader {
   public:
+  // Per-name bookkeeping, the callbacks themselves live in the dispatch arena
   struct Gauge {
     void *handle;
-    GaugeInitFunc init;
-    GaugeDrawFunc draw;
-    GaugeKillFunc kill;
-    GaugeUpdateFunc update;
-    GaugeMouseHandlerFunc mouse_handler;
-
+    GaugeHandle dispatch;
 
     struct MountParams {
       int width;
       int height;
       std::string str_params;
+      bool parallel_update;  // update() may run on the worker pool instead of the main thread
+      bool always_redraw;  // keep rendering every frame even when the emulator is idle (time driven animation)
+      GaugeIsolation isolation;
+      size_t heap_limit;  // bytes, 0 for no cap, see HeapTracker
+      bool heap_arena;  // serve the gauge's allocations from its own arena, dropped as a whole on unload
+      size_t host_memory;  // bytes of address space for a process isolated gauge's host, 0 for no cap
+      int host_cpu_percent;  // of one core for a process isolated gauge's host, 0 for no cap
     };
     MountParams mount_params;
+    std::string shadow_path;  // private copy that was actually dlopen'ed, see ShadowCopy; empty when hosted
+    uint64_t image_hash;
   };
 
   static GaugeLoader *GetInstance() {
@@ -46,43 +61,34 @@ class GaugeLoader {
   }
 
 
-  void UpdateGauges(float dTime) {
-    for (const auto &gauge: m_Gauges) {
-      if (gauge.second.second.update) {
-        gauge.second.second.update(gauge.second.first, dTime);
-      }
-    }
-  }
-  bool IsUpdateQueued() { return m_IsUpdateQueued; }
-  void SetUpdateQueued(bool queued) { m_IsUpdateQueued = queued; }
-  std::unordered_map<std::string, std::pair<unsigned long long, Gauge>> GetAllGauges() const { return m_Gauges; }
-  std::vector<std::pair<std::string, double>> GetVariables() const { return m_Variables; }
-  int AddVariable(const std::string &name, double value) {
-    for (int i = 0; i < m_Variables.size(); ++i) {
-      if (m_Variables[i].first == name) {
-        return i;
-      }
-    }
-
-    m_Variables.emplace_back(name, value);
-    return m_Variables.size() - 1;
-  }
-  void RemoveVariable(const std::string &name) {
-    for (int i = 0; i < m_Variables.size(); ++i) {
-      if (m_Variables[i].first == name) {
-        m_Variables.erase(m_Variables.begin() + i);
-      }
-    }
-  }
-  double GetVariable(const std::string &name) {
-    for (int i = 0; i < m_Variables.size(); ++i) {
-      if (m_Variables[i].first == name) {
-        return m_Variables[i].second;
+  void UpdateGauges(float dTime);
+  void SetForceSerialUpdate(bool force) { m_ForceSerialUpdate = force; }
+  bool IsForceSerialUpdate() const { return m_ForceSerialUpdate; }
+  double GetLastUpdateTime() const { return m_LastUpdateMs; }
+  WorkerPool *GetUpdatePool() const { return m_UpdatePool.get(); }
+  bool WantsContinuousRedraw() const;
+  const std::unordered_map<std::string, Gauge> &GetAllGauges() const { return m_Gauges; }
+  GaugeDispatch *GetDispatch(const GaugeHandle handle) const { return m_Dispatch.Get(handle); }
+  // The name the gauge with this ctx was loaded under, "(emulator)" for 0 and "ctx N (unloaded)" once it is gone
+  std::string GetGaugeName(unsigned long long ctx) const;
+  const std::vector<std::pair<std::string, double>> &GetVariables() const { return m_Variables; }
+  size_t GetVariableCount() const { return m_Variables.size(); }
+  const std::string &GetVariableName(const int id) const { return m_Variables[id].first; }
+  // Safe from any thread that runs a gauge update. While parallel updates are in flight the new id is announced to
+  // subscribers at the update barrier.
+  int AddVariable(const std::string &name, double value);
+  // Ids are handed to gauges, so a removed variable keeps its slot (empty name, value 0) instead of shifting the rest
+  void RemoveVariable(const std::string &name);
+  bool IsVariableRegistered(const int id) const { return m_VariableIndex.Contains(id); }
+  double GetVariable(const std::string &name);
+  double GetVariable(const int id) {
+    // An update running beside others sees its own writes before they are applied
+    if (s_DeferredWrites) {
+      for (auto it = s_DeferredWrites->rbegin(); it != s_DeferredWrites->rend(); ++it) {
+        if (it->first == id) return it->second;
       }
     }
-    return 0;
-  }
-  double GetVariable(const int id) {
+    const auto lock = LockVariablesShared();
     if (id >= 0 && id < m_Variables.size()) return m_Variables[id].second;
     return 0;
   }
@@ -92,25 +98,125 @@ class GaugeLoader {
     }
   }
 
-  void UpdateVariable(const int id, double value) { m_Variables[id].second = value; }
+  // Writes made while parallel updates are in flight are buffered per gauge and applied at the update barrier
+  void UpdateVariable(int id, double value);
+  // Every effective write moves the epoch forward and stamps the variable with it, readers compare against a snapshot.
+  // Writes land on the main thread only (parallel ones at the barrier), the epoch may be polled from anywhere.
+  const std::vector<uint64_t> &GetVariableVersions() const { return m_VariableVersions; }
+  uint64_t GetVariableEpoch() const { return m_VariableEpoch.load(std::memory_order_acquire); }
+
+  struct VariableChange {
+    uint64_t epoch;
+    int id;
+    double value;
+  };
+  // Appends every change after epoch, oldest first. Returns false when the log no longer reaches back that far, the
+  // caller missed changes and has to re-read the variables it cares about.
+  bool GetChangesSince(uint64_t epoch, std::vector<VariableChange> &out) const;
+
+  using VariableCallback = std::function<void(int id, double value)>;
+  // The callback runs on the main thread right after the change, writes from parallel updates are delivered at the
+  // update barrier. id -1 subscribes to every variable. Don't (un)subscribe from inside a callback.
+  uint64_t Subscribe(int id, VariableCallback callback);
+  void Unsubscribe(uint64_t subscription);
+  TrigramIndex &GetVariableIndex() { return m_VariableIndex; }
+
+  std::vector<InstrumentRenderer> &GetAllRenderers() { return m_Renderers; }
+
+  GaugeHandle GetOrLoadGauge(const std::string &gauge_path, const std::string &gauge_name);
 
-  std::vector<InstrumentRenderer> GetAllRenderers() { return m_Renderers; }
+  // keep_state asks the gauge for a snapshot before kill, the next load of the same name restores it
+  std::expected<void, std::string> UnloadGauge(const std::string &gauge_name, bool keep_state = false);
 
-  std::pair<unsigned long long, Gauge> GetOrLoadGauge(const std::string &gauge_path, const std::string &gauge_name);
+  // Progress of a RequestLoad, written by the loader thread and read by the UI
+  struct PendingLoad {
+    enum class Phase { Copying, Parsing, CheckingImports, Opening, Resolving, Initializing };
+    static const char *PhaseName(Phase phase);
 
-  std::expected<void, std::string> UnloadGauge(const std::string &gauge_name);
+    std::string gauge_name;
+    std::string gauge_path;
+    std::atomic<Phase> phase = Phase::Copying;
+    std::atomic<bool> cancelled = false;  // superseded by a newer request for the same gauge
+    std::chrono::steady_clock::time_point started;
+  };
+
+  // Copies, opens and resolves the gauge on a loader thread; only init runs on the main thread. A loaded gauge of the
+  // same name keeps rendering until the new version is ready and is then swapped out with its state kept.
+  void RequestLoad(const std::string &gauge_path, const std::string &gauge_name,
+                   std::optional<ShadowCopy::Result> shadow = std::nullopt);
+  const std::vector<std::shared_ptr<PendingLoad>> &GetPendingLoads() const { return m_PendingLoads; }
+  const std::string &GetLastLoadError() const { return m_LastLoadError; }
+  // RTLD_NOW instead of RTLD_LAZY: unresolved imports fail the load and first frames don't pay for PLT resolution
+  void SetEagerBinding(bool eager) { m_EagerBinding = eager; }
+  bool IsEagerBinding() const { return m_EagerBinding; }
+  // File watchers poll for rebuilds; soak runs turn them off so every unload doesn't leave a thread winding down
+  void SetWatchFiles(bool watch) { m_WatchFiles = watch; }
+  // Gives every gauge loaded from now on an arena heap, as if its json set heap_arena
+  void SetArenaHeaps(bool arena) { m_ArenaHeaps = arena; }
+  bool IsArenaHeaps() const { return m_ArenaHeaps; }
+  // fs*/nvg* imports of each loaded gauge that the emulator doesn't export
+  const std::unordered_map<std::string, std::vector<std::string>> &GetMissingImports() const {
+    return m_MissingImports;
+  }
   std::expected<void, std::string> UnloadAllGauges();
 
   bool AreGaugesLoaded() const { return !m_Gauges.empty(); }
 
+  // Main thread, after callbacks ran under a FaultGuard: marks the gauges that faulted, prints where and keeps a one
+  // line summary until they're reloaded
+  void ProcessFaults();
+  const std::unordered_map<std::string, std::string> &GetFaults() const { return m_Faults; }
+
+  // Phases of the most recent load and unload in ms, a reload overwrites both halves. Phases that didn't run (copy of
+  // a watcher's ready made shadow, kill of a gauge without one) are 0.
+  struct ReloadStats {
+    double copy;
+    double parse;
+    double check_imports;
+    double open;  // dlopen, plus relocation patching for deepbind and namespace gauges
+    double resolve;
+    double init;
+    double save_state;
+    double kill;  // pre_kill and kill
+    double close;  // dlclose, static destructors included, and removing the shadow copy
+    uint64_t leaked_bytes;  // still held by the gauge after close, see HeapTracker::Detach
+    uint64_t leaked_blocks;
+  };
+  const ReloadStats &GetReloadStats() const { return m_ReloadStats; }
+
+  // Forces the gauge with this ctx to draw next frame, backs fsEmulatorRequestRedraw
+  void InvalidateGauge(unsigned long long ctx);
+  // Reuse a gauge's last image when none of the simvars it read changed, see GaugeReadSet
+  void SetSkipUnchangedDraws(bool skip) { m_SkipUnchangedDraws = skip; }
+  bool IsSkipUnchangedDraws() const { return m_SkipUnchangedDraws; }
+  struct DrawStats {
+    uint64_t drawn;
+    uint64_t skipped;
+  };
+  DrawStats &GetDrawStats() { return m_DrawStats; }
+
   private:
-  std::expected<std::pair<unsigned long long, Gauge>, std::string> LoadGauge(const std::string &gauge_path,
-                                                                             const std::string &gauge_name);
+  // Stamps the variable with a new epoch, logs it and notifies subscribers
+  void RecordChange(int id);
 
-  std::pair<unsigned long long, Gauge> GetFromMap(const std::string &gauge_name) const;
+  std::expected<Gauge, std::string> LoadGauge(const std::string &gauge_path, const std::string &gauge_name);
+  struct PreparedGauge {
+    Gauge gauge;
+    GaugeCallbacks callbacks;
+    std::vector<std::string> missing_imports;
+    ReloadStats stats;  // load phases up to resolve
+  };
+  // Thread safe part of a load, nullopt when the build matches loaded_hash
+  static std::expected<std::optional<PreparedGauge>, std::string> PrepareGauge(
+      const std::string &gauge_path, const std::string &gauge_name, std::optional<ShadowCopy::Result> shadow,
+      uint64_t loaded_hash, bool bind_now, PendingLoad *progress);
+  std::expected<Gauge, std::string> InstallGauge(const std::string &gauge_path, const std::string &gauge_name,
+                                                 const PreparedGauge &prepared);
+  void FinishLoad(const std::shared_ptr<PendingLoad> &pending,
+                  std::expected<std::optional<PreparedGauge>, std::string> result);
 
   static std::optional<Gauge::MountParams> ParseJson(const std::string &json_path) {
-    Gauge::MountParams params{0, 0, ""};
+    Gauge::MountParams params{0, 0, "", false, false, GaugeIsolation::Local, 0, false, 0, 0};
     if (!std::filesystem::exists(json_path)) {
       return std::nullopt;
     }
@@ -127,6 +233,32 @@ class GaugeLoader {
       params.width = json["gauge"]["size"]["width"].get<int>();
       params.height = json["gauge"]["size"]["height"].get<int>();
       params.str_params = json["gauge"]["string_params"].get<std::string>();
+      if (json["gauge"].contains("parallel_update")) {
+        params.parallel_update = json["gauge"]["parallel_update"].get<bool>();
+      }
+      if (json["gauge"].contains("always_redraw")) {
+        params.always_redraw = json["gauge"]["always_redraw"].get<bool>();
+      }
+      if (json["gauge"].contains("isolation")) {
+        const auto isolation = GaugeLinker::ParseIsolation(json["gauge"]["isolation"].get<std::string>());
+        if (!isolation.has_value()) {
+          std::cerr << "Unknown isolation mode, expected global, local, deepbind, namespace or process" << std::endl;
+          return std::nullopt;
+        }
+        params.isolation = isolation.value();
+      }
+      if (json["gauge"].contains("heap_limit_mb")) {
+        params.heap_limit = json["gauge"]["heap_limit_mb"].get<size_t>() * 1024 * 1024;
+      }
+      if (json["gauge"].contains("heap_arena")) {
+        params.heap_arena = json["gauge"]["heap_arena"].get<bool>();
+      }
+      if (json["gauge"].contains("host_memory_mb")) {
+        params.host_memory = json["gauge"]["host_memory_mb"].get<size_t>() * 1024 * 1024;
+      }
+      if (json["gauge"].contains("host_cpu_percent")) {
+        params.host_cpu_percent = json["gauge"]["host_cpu_percent"].get<int>();
+      }
     } catch (const std::exception &e) {
       std::cerr << e.what() << std::endl;
       return std::nullopt;
@@ -135,33 +267,123 @@ class GaugeLoader {
     return params;
   }
 
+  private:
+  static void RunUpdateJob(void *arg) {
+    auto *dispatch = static_cast<GaugeDispatch *>(arg);
+    s_DeferredWrites = &dispatch->writes;
+    {
+      CallbackScope scope(dispatch->ctx, &dispatch->reads, false);
+      PerfCounters::Measurement measurement(dispatch->ctx, PerfCounters::Callback::Update);
+      FaultGuard::Run(dispatch->ctx, FaultGuard::Callback::Update,
+                      [dispatch] { dispatch->update(dispatch->ctx, dispatch->update_dtime); });
+    }
+    s_DeferredWrites = nullptr;
+    SimVarProfiler::FlushThread();
+  }
+
   private:
   static GaugeLoader *m_Instance;
-  bool m_IsUpdateQueued = false;
+  // Set while this thread runs an update alongside others, UpdateVariable appends to it instead of writing
+  static thread_local std::vector<std::pair<int, double>> *s_DeferredWrites;
+
+  std::unique_ptr<WorkerPool> m_UpdatePool;
+  bool m_ForceSerialUpdate = false;
+  double m_LastUpdateMs = 0.0;
 
-  std::unordered_map<std::string, std::pair<unsigned long long, Gauge>> m_Gauges;  // <gauge_name, <ctx, Gauge>
+  GaugeArena m_Dispatch;
+  std::unordered_map<std::string, Gauge> m_Gauges;  // <gauge_name, Gauge>
   std::vector<InstrumentRenderer> m_Renderers;
+  std::unordered_map<std::string, std::shared_ptr<std::atomic<bool>>> m_Watchers;  // <gauge_name, stop flag>
+  std::vector<std::shared_ptr<PendingLoad>> m_PendingLoads;
+  std::string m_LastLoadError;
+  bool m_EagerBinding = false;
+  bool m_ArenaHeaps = false;
+  bool m_WatchFiles = true;
+  ReloadStats m_ReloadStats{};
+  std::unordered_map<std::string, std::vector<std::string>> m_MissingImports;
+  std::unordered_map<std::string, std::string> m_Faults;  // <gauge_name, what happened>
+  std::unordered_map<std::string, std::unique_ptr<GaugeHost>> m_Hosts;  // <gauge_name, child running it>
+  bool m_SkipUnchangedDraws = true;
+  DrawStats m_DrawStats{0, 0};
   std::vector<std::pair<std::string, double>> m_Variables;
+  std::vector<uint64_t> m_VariableVersions;  // parallel to m_Variables
+  std::atomic<uint64_t> m_VariableEpoch{0};
+  static constexpr size_t CHANGE_LOG_SIZE = 4096;
+  std::vector<VariableChange> m_ChangeLog = std::vector<VariableChange>(CHANGE_LOG_SIZE);  // indexed by epoch
+  struct Subscription {
+    uint64_t id;
+    int variable;
+    VariableCallback callback;
+  };
+  std::vector<Subscription> m_Subscriptions;
+  uint64_t m_NextSubscription = 1;
+  std::unordered_map<std::string, int> m_VariableIds;
+  // Only taken while parallel updates run, when a registration from one update may reallocate the tables under reads
+  // from the others. The rest of the time every access is on the main thread.
+  mutable std::shared_mutex m_VariablesMutex;
+  std::atomic<bool> m_ParallelUpdates{false};
+  std::vector<int> m_RegisteredDuringUpdate;  // changes RecordChange publishes at the barrier
+  std::shared_lock<std::shared_mutex> LockVariablesShared() const {
+    return m_ParallelUpdates.load(std::memory_order_relaxed) ? std::shared_lock(m_VariablesMutex)
+                                                             : std::shared_lock<std::shared_mutex>();
+  }
+  TrigramIndex m_VariableIndex;  // fuzzy search over m_Variables names, kept in sync by Add/RemoveVariable
 };
 
 struct NVGcontext;
 
 class InstrumentRenderer {
   public:
-  InstrumentRenderer(const std::string &title, const unsigned long long gaugeCtx, GaugeLoader::Gauge gauge)
+  InstrumentRenderer(const std::string &title, const GaugeHandle gauge, const int width, const int height)
       : m_Title(title)
-      , m_GaugeCtx(gaugeCtx)
-      , m_gauge(gauge) {}
+      , m_Gauge(gauge)
+      , m_Width(width)
+      , m_Height(height) {}
+  ~InstrumentRenderer();
+
+  // Owns GL objects, moved around by the renderer list but never copied
+  InstrumentRenderer(InstrumentRenderer &&other) noexcept;
+  InstrumentRenderer &operator=(InstrumentRenderer &&other) noexcept;
+  InstrumentRenderer(const InstrumentRenderer &) = delete;
+  InstrumentRenderer &operator=(const InstrumentRenderer &) = delete;
 
   void CreateImGuiWindow();
+  // Draws the gauge into its framebuffer when something it reads changed, otherwise the last image is shown again.
+  // Has to run after CreateImGuiWindow and before ImGui's draw data is rendered.
   void RenderContents();
+  // RenderContents without an ImGui window, for headless runs and gauge hosts: lays the gauge out at its json size,
+  // force draws even when nothing it reads changed
+  void RenderOffscreen(bool force);
 
   std::string GetTitle() const { return m_Title; }
+  GaugeHandle GetGauge() const { return m_Gauge; }
+  unsigned int GetFramebuffer() const { return m_Framebuffer; }
+  int GetFramebufferWidth() const { return m_FramebufferWidth; }
+  int GetFramebufferHeight() const { return m_FramebufferHeight; }
+  // Shows frames of a process isolated gauge instead of drawing it, owned by the loader
+  void SetHost(GaugeHost *host) { m_Host = host; }
 
   private:
+  bool ResizeFramebuffer(int width, int height);
+  void DeleteFramebuffer();
+  // Mouse position in the hosted gauge's json sized frame, whatever size the window shows it at
+  ImVec2 GetHostMousePosition() const;
+
   std::string m_Title;
-  static ImVec2 m_Size;
-  unsigned long long m_GaugeCtx;
-  static ImVec2 m_Position;
-  GaugeLoader::Gauge m_gauge;
+  GaugeHandle m_Gauge;
+  int m_Width;
+  int m_Height;
+  ImVec2 m_Position{0.0f, 0.0f};
+  ImVec2 m_Size{0.0f, 0.0f};
+
+  ImVec2 m_LastMouse{0.0f, 0.0f};
+  bool m_Hovered = false;
+  bool m_InputPending = false;  // hover, motion or a click over the gauge, draw_data carries the mouse position
+
+  unsigned int m_Framebuffer = 0;
+  unsigned int m_ColorTexture = 0;
+  unsigned int m_StencilBuffer = 0;  // NanoVG fills paths through the stencil buffer
+  int m_FramebufferWidth = 0;
+  int m_FramebufferHeight = 0;
+  GaugeHost *m_Host = nullptr;
 };
@@ -0,0 +1,100 @@
+#include "ReloadCache.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <ranges>
+
+ReloadCache *ReloadCache::m_Instance = nullptr;
+
+void ReloadCache::StoreState(const std::string &gauge_name, sEmulatorStateBuffer &&buffer) {
+  std::lock_guard lock(m_Mutex);
+  m_Snapshots[gauge_name] = std::move(buffer.data);
+}
+
+void ReloadCache::DropState(const std::string &gauge_name) {
+  std::lock_guard lock(m_Mutex);
+  m_Snapshots.erase(gauge_name);
+}
+
+void ReloadCache::BeginRestore(const unsigned long long ctx, const std::string &gauge_name) {
+  std::lock_guard lock(m_Mutex);
+  const auto it = m_Snapshots.find(gauge_name);
+  if (it == m_Snapshots.end()) {
+    return;
+  }
+  m_Restoring[ctx] = std::move(it->second);
+  m_Snapshots.erase(it);
+}
+
+void ReloadCache::EndRestore(const unsigned long long ctx) {
+  std::lock_guard lock(m_Mutex);
+  m_Restoring.erase(ctx);
+}
+
+const void *ReloadCache::GetRestoredState(const unsigned long long ctx, unsigned long *size) {
+  std::lock_guard lock(m_Mutex);
+  const auto it = m_Restoring.find(ctx);
+  if (it == m_Restoring.end()) {
+    if (size) *size = 0;
+    return nullptr;
+  }
+  m_Restores++;
+  if (size) *size = it->second.size();
+  return it->second.data();
+}
+
+const unsigned char *ReloadCache::LoadResource(const std::string &path, unsigned long *size) {
+  if (size) *size = 0;
+
+  std::error_code error_code;
+  const auto mtime = std::filesystem::last_write_time(path, error_code);
+  if (error_code) {
+    std::cerr << "[ReloadCache] Failed to stat " << path << ": " << error_code.message() << std::endl;
+    return nullptr;
+  }
+  const auto file_size = std::filesystem::file_size(path, error_code);
+  if (error_code) {
+    std::cerr << "[ReloadCache] Failed to stat " << path << ": " << error_code.message() << std::endl;
+    return nullptr;
+  }
+
+  std::lock_guard lock(m_Mutex);
+  auto &resource = m_Resources[path];
+  if (resource.bytes && resource.mtime == mtime && resource.file_size == file_size) {
+    m_ResourceHits++;
+    if (size) *size = resource.bytes->size();
+    return resource.bytes->data();
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "[ReloadCache] Failed to open " << path << std::endl;
+    return nullptr;
+  }
+  auto bytes = std::make_unique<std::vector<unsigned char>>(file_size);
+  if (!file.read(reinterpret_cast<char *>(bytes->data()), static_cast<std::streamsize>(file_size))) {
+    std::cerr << "[ReloadCache] Failed to read " << path << std::endl;
+    return nullptr;
+  }
+
+  if (resource.bytes) {
+    m_RetiredResources.push_back(std::move(resource.bytes));
+  }
+  resource = Resource{mtime, file_size, std::move(bytes)};
+  m_ResourceMisses++;
+
+  if (size) *size = resource.bytes->size();
+  return resource.bytes->data();
+}
+
+ReloadCache::Stats ReloadCache::GetStats() {
+  std::lock_guard lock(m_Mutex);
+  Stats stats{m_Snapshots.size(), 0, m_Resources.size(), 0, m_ResourceHits, m_ResourceMisses, m_Restores};
+  for (const auto &snapshot: m_Snapshots | std::views::values) {
+    stats.snapshot_bytes += snapshot.size();
+  }
+  for (const auto &resource: m_Resources | std::views::values) {
+    if (resource.bytes) stats.resource_bytes += resource.bytes->size();
+  }
+  return stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Handed to a gauge's save_state export, the gauge appends its snapshot with fsEmulatorStateWrite
+struct sEmulatorStateBuffer {
+  std::vector<unsigned char> data;
+};
+
+// Survives gauge reloads: state snapshots keyed by gauge name and immutable resource bytes keyed by path.
+// Snapshots are consumed by the next init of the same gauge, resources are revalidated by mtime and size.
+class ReloadCache {
+  public:
+  static ReloadCache *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new ReloadCache();
+    }
+    return m_Instance;
+  }
+
+  struct Stats {
+    size_t snapshots;
+    size_t snapshot_bytes;
+    size_t resources;
+    size_t resource_bytes;
+    uint64_t resource_hits;
+    uint64_t resource_misses;
+    uint64_t restores;
+  };
+
+  void StoreState(const std::string &gauge_name, sEmulatorStateBuffer &&buffer);
+  void DropState(const std::string &gauge_name);
+
+  // Moves the gauge's snapshot to ctx for the duration of init, EndRestore discards it whether it was read or not
+  void BeginRestore(unsigned long long ctx, const std::string &gauge_name);
+  void EndRestore(unsigned long long ctx);
+  const void *GetRestoredState(unsigned long long ctx, unsigned long *size);
+
+  const unsigned char *LoadResource(const std::string &path, unsigned long *size);
+
+  Stats GetStats();
+
+  private:
+  ReloadCache() = default;
+
+  struct Resource {
+    std::filesystem::file_time_type mtime;
+    uintmax_t file_size;
+    std::unique_ptr<std::vector<unsigned char>> bytes;
+  };
+
+  static ReloadCache *m_Instance;
+
+  std::mutex m_Mutex;
+  std::unordered_map<std::string, std::vector<unsigned char>> m_Snapshots;
+  std::unordered_map<unsigned long long, std::vector<unsigned char>> m_Restoring;
+  std::unordered_map<std::string, Resource> m_Resources;
+  // nanovg keeps pointers into font data (freeData = 0), so replaced buffers are parked here instead of freed
+  std::vector<std::unique_ptr<std::vector<unsigned char>>> m_RetiredResources;
+  uint64_t m_ResourceHits = 0;
+  uint64_t m_ResourceMisses = 0;
+  uint64_t m_Restores = 0;
+};
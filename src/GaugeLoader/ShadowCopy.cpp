@@ -0,0 +1,116 @@
+#include "ShadowCopy.hpp"
+
+#include "ElfFile.hpp"
+//
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <linux/fs.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <unordered_map>
+
+static std::mutex s_ReferencesMutex;
+static std::unordered_map<std::string, int> s_References;  // <shadow path, Create results not yet removed>
+
+std::string ShadowCopy::GetDirectory() {
+  // Leaked on purpose, the atexit handler below still needs it after static destructors have run
+  static const std::string *directory = []() {
+    const auto path = std::filesystem::temp_directory_path() / ("fs2024-emulator-" + std::to_string(getpid()));
+    std::error_code error_code;
+    std::filesystem::create_directories(path, error_code);
+    if (error_code) {
+      std::cerr << "[ShadowCopy] Failed to create " << path << ": " << error_code.message() << std::endl;
+    }
+    // Loaded libraries stay mapped after their file is gone, so the whole directory can go at exit
+    std::atexit([]() {
+      std::error_code ignored;
+      std::filesystem::remove_all(GetDirectory(), ignored);
+    });
+    return new std::string(path.string());
+  }();
+  return *directory;
+}
+
+static bool reflink_file(const std::string &source_path, const std::string &destination_path) {
+  const int source = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source < 0) {
+    return false;
+  }
+  const int destination = open(destination_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+  if (destination < 0) {
+    close(source);
+    return false;
+  }
+  const bool cloned = ioctl(destination, FICLONE, source) == 0;
+  close(destination);
+  close(source);
+  return cloned;
+}
+
+std::expected<ShadowCopy::Result, std::string> ShadowCopy::Create(const std::string &source_path) {
+  static std::atomic<unsigned> temp_counter = 0;
+  const auto start = std::chrono::steady_clock::now();
+
+  const std::filesystem::path directory = GetDirectory();
+  const std::string stem = std::filesystem::path(source_path).stem().string();
+  const auto temp_path = directory / ("." + stem + "-" + std::to_string(temp_counter++) + ".tmp");
+
+  // Snapshot first, then validate the snapshot: the build can keep writing the source without affecting what we load
+  const bool reflinked = reflink_file(source_path, temp_path.string());
+  if (!reflinked) {
+    std::error_code error_code;
+    std::filesystem::copy_file(source_path, temp_path, std::filesystem::copy_options::overwrite_existing, error_code);
+    if (error_code) {
+      std::filesystem::remove(temp_path, error_code);
+      return std::unexpected("Failed to copy " + source_path + ": " + error_code.message());
+    }
+  }
+
+  auto elf = ElfFile::Load(temp_path.string());
+  if (!elf.has_value()) {
+    std::error_code error_code;
+    std::filesystem::remove(temp_path, error_code);
+    return std::unexpected(source_path + ": " + elf.error());
+  }
+  const uint64_t hash = elf->GetHash();
+
+  char hash_string[17];
+  std::snprintf(hash_string, sizeof(hash_string), "%016llx", static_cast<unsigned long long>(hash));
+  const auto shadow_path = directory / (stem + "-" + hash_string + ".so");
+
+  std::error_code error_code;
+  {
+    // Held across the check and the rename so a concurrent Remove can't delete the file we're about to hand out
+    std::lock_guard lock(s_ReferencesMutex);
+    if (std::filesystem::exists(shadow_path, error_code)) {
+      std::filesystem::remove(temp_path, error_code);
+    } else {
+      std::filesystem::rename(temp_path, shadow_path, error_code);
+      if (error_code) {
+        std::filesystem::remove(temp_path, error_code);
+        return std::unexpected("Failed to create shadow copy of " + source_path + ": " + error_code.message());
+      }
+    }
+    s_References[shadow_path.string()]++;
+  }
+
+  const double copy_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return Result{shadow_path.string(), hash, reflinked, copy_ms};
+}
+
+void ShadowCopy::Remove(const std::string &shadow_path) {
+  std::lock_guard lock(s_ReferencesMutex);
+  const auto it = s_References.find(shadow_path);
+  if (it == s_References.end() || --it->second > 0) {
+    return;
+  }
+  s_References.erase(it);
+  std::error_code error_code;
+  std::filesystem::remove(shadow_path, error_code);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <expected>
+#include <string>
+
+// Gauges are never dlopen'ed from the build output. Each build is snapshotted (reflinked when the filesystem supports
+// it) into a private directory under a content hashed name, validated, and only then handed to the dynamic loader, so
+// a half-written .so can't be loaded and two versions never share a path in glibc's handle cache.
+class ShadowCopy {
+  public:
+  struct Result {
+    std::string path;
+    uint64_t hash;
+    bool reflinked;
+    double copy_ms;
+  };
+
+  // Identical builds share one path, which is reference counted: every successful Create is matched by exactly one
+  // Remove and the file goes with the last one, so unloading a version can't delete it under a queued load of it.
+  static std::expected<Result, std::string> Create(const std::string &source_path);
+  static void Remove(const std::string &shadow_path);
+
+  private:
+  static std::string GetDirectory();
+};
@@ -0,0 +1,286 @@
+#include "Watchdog.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <filesystem>
+#include <iostream>
+#include <pthread.h>
+#include <thread>
+#include <ucontext.h>
+#include <unordered_map>
+
+Watchdog *Watchdog::m_Instance = nullptr;
+
+static constexpr uint32_t MAX_THREADS = 64;  // the main thread and the update workers, in practice
+static constexpr size_t MAX_HANGS = 32;
+static constexpr int MAX_DEPTH = 32;
+static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(5);
+static constexpr auto SAMPLE_TIMEOUT = std::chrono::milliseconds(100);
+// A gauge that is slow every frame is sampled once per interval, the other reports are only counted
+static constexpr auto REPORT_INTERVAL = std::chrono::seconds(1);
+
+enum Request : int { NONE, SAMPLE, ABANDON, DEFERRED };  // DEFERRED: the abandon hit a lock, retry it
+
+// One per thread that ran a guarded callback. Written by that thread, read by the watchdog.
+struct Heartbeat {
+  std::atomic<bool> used;
+  pthread_t thread;
+  std::atomic<uint64_t> beat;  // outermost callbacks started on this thread
+  std::atomic<int64_t> since;  // steady clock ns the running callback started at, 0 while idle
+  std::atomic<unsigned long long> ctx;
+  std::atomic<int> callback;
+  // The watchdog sets request for a beat and signals the thread, whose handler clears it once done
+  std::atomic<uint64_t> request_beat;
+  std::atomic<int> request;
+  int depth;
+  void *frames[MAX_DEPTH];
+};
+static Heartbeat s_Beats[MAX_THREADS];
+
+struct BeatSlot {
+  Heartbeat *beat = nullptr;
+  bool unwatched = false;  // no slot was free
+
+  ~BeatSlot() {
+    if (beat) {
+      beat->used.store(false, std::memory_order_release);
+    }
+  }
+};
+static thread_local BeatSlot t_Slot;
+
+static int watchdog_signal() { return SIGRTMIN + 1; }
+
+static int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void *interrupted_pc(void *ucontext) {
+#if defined(__x86_64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.pc);
+#else
+  return nullptr;
+#endif
+}
+
+// Runs on the stuck thread
+static void handle_watchdog_signal(int, siginfo_t *, void *ucontext) {
+  Heartbeat *heartbeat = t_Slot.beat;
+  if (!heartbeat) {
+    return;
+  }
+  const int saved_errno = errno;
+  const int request = heartbeat->request.load(std::memory_order_acquire);
+  const int64_t since = heartbeat->since.load(std::memory_order_relaxed);
+  // The callback the request was made for may have returned while the signal was on its way
+  const bool current = since != 0 &&
+      heartbeat->request_beat.load(std::memory_order_relaxed) == heartbeat->beat.load(std::memory_order_relaxed);
+  if (request == SAMPLE && current) {
+    // Like FaultGuard, the interrupted instruction marks where the stack below the signal trampoline starts
+    void *frames[MAX_DEPTH + 8];
+    const int count = backtrace(frames, MAX_DEPTH + 8);
+    void *pc = interrupted_pc(ucontext);
+    const int first = static_cast<int>(std::find(frames, frames + count, pc) - frames);
+    if (first == count) {
+      heartbeat->frames[0] = pc;
+      heartbeat->depth = 1;
+    } else {
+      heartbeat->depth = std::min(count - first, MAX_DEPTH);
+      std::memcpy(heartbeat->frames, frames + first, heartbeat->depth * sizeof(void *));
+    }
+  }
+  const bool deferred = request == ABANDON && current && Watchdog::s_NoAbandon > 0;
+  heartbeat->request.store(deferred ? DEFERRED : NONE, std::memory_order_release);
+  errno = saved_errno;
+  if (request == ABANDON && current && !deferred) {
+    FaultGuard::Abandon(static_cast<int>((now_ns() - since) / 1'000'000), ucontext);
+  }
+}
+
+// dladdr only: Symbolize caches on the main thread, which may well be the one that's stuck
+static std::string describe_pc(const uintptr_t pc) {
+  Dl_info info{};
+  char offset[32];
+  if (dladdr(reinterpret_cast<void *>(pc), &info) == 0 || !info.dli_fname) {
+    std::snprintf(offset, sizeof(offset), "0x%llx", static_cast<unsigned long long>(pc));
+    return offset;
+  }
+  const std::string module = std::filesystem::path(info.dli_fname).filename().string();
+  if (!info.dli_sname) {
+    std::snprintf(offset, sizeof(offset), "+0x%llx",
+                  static_cast<unsigned long long>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+    return module + offset;
+  }
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+  const std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+  std::free(demangled);
+  std::snprintf(offset, sizeof(offset), "+0x%llx",
+                static_cast<unsigned long long>(pc - reinterpret_cast<uintptr_t>(info.dli_saddr)));
+  return module + "!" + name + offset;
+}
+
+void Watchdog::Beat(const unsigned long long ctx, const FaultGuard::Callback callback) {
+  Heartbeat *heartbeat = t_Slot.beat;
+  if (!heartbeat) {
+    if (t_Slot.unwatched) {
+      return;
+    }
+    for (auto &candidate: s_Beats) {
+      bool expected = false;
+      if (candidate.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        candidate.thread = pthread_self();
+        heartbeat = t_Slot.beat = &candidate;
+        break;
+      }
+    }
+    if (!heartbeat) {
+      t_Slot.unwatched = true;
+      return;
+    }
+  }
+  heartbeat->ctx.store(ctx, std::memory_order_relaxed);
+  heartbeat->callback.store(static_cast<int>(callback), std::memory_order_relaxed);
+  heartbeat->beat.store(heartbeat->beat.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  heartbeat->since.store(now_ns(), std::memory_order_release);
+}
+
+void Watchdog::Rest() {
+  if (Heartbeat *heartbeat = t_Slot.beat) {
+    heartbeat->since.store(0, std::memory_order_release);
+  }
+}
+
+std::expected<void, std::string> Watchdog::Start() {
+  if (m_Running) {
+    return {};
+  }
+  // backtrace() loads libgcc_s on its first call, which must not happen inside the signal handler
+  void *warmup[1];
+  backtrace(warmup, 1);
+
+  struct sigaction action {};
+  action.sa_sigaction = handle_watchdog_signal;
+  // Interrupted reads and sleeps of a callback that's only sampled carry on. SA_NODEFER because abandoning jumps out of
+  // the handler without restoring the signal mask, which would leave the signal blocked on that thread for good.
+  action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK | SA_NODEFER;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(watchdog_signal(), &action, nullptr) != 0) {
+    return std::unexpected(std::string("sigaction failed: ") + std::strerror(errno));
+  }
+  std::thread([this] {
+    pthread_setname_np(pthread_self(), "watchdog");
+    Run();
+  }).detach();
+  m_Running = true;
+  return {};
+}
+
+std::vector<Watchdog::Hang> Watchdog::GetRecentHangs() const {
+  std::lock_guard lock(m_HangsMutex);
+  return {m_Hangs.begin(), m_Hangs.end()};
+}
+
+Watchdog::Hang Watchdog::Sample(const uint32_t slot, const uint64_t beat, const double ms) {
+  Heartbeat &heartbeat = s_Beats[slot];
+  Hang hang{heartbeat.ctx.load(std::memory_order_relaxed),
+            static_cast<FaultGuard::Callback>(heartbeat.callback.load(std::memory_order_relaxed)), ms, {}};
+  heartbeat.depth = 0;
+  heartbeat.request_beat.store(beat, std::memory_order_relaxed);
+  heartbeat.request.store(SAMPLE, std::memory_order_release);
+  if (pthread_kill(heartbeat.thread, watchdog_signal()) != 0) {
+    heartbeat.request.store(NONE, std::memory_order_relaxed);
+    return hang;
+  }
+  // A thread blocking the signal or stuck in an uninterruptible syscall never answers
+  const auto deadline = std::chrono::steady_clock::now() + SAMPLE_TIMEOUT;
+  while (heartbeat.request.load(std::memory_order_acquire) != NONE) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return hang;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (int i = 0; i < heartbeat.depth; i++) {
+    // Outer frames hold return addresses, step back into the call instruction
+    hang.stack.push_back(describe_pc(reinterpret_cast<uintptr_t>(heartbeat.frames[i]) - (i > 0 ? 1 : 0)));
+  }
+  return hang;
+}
+
+void Watchdog::Run() {
+  uint64_t reported[MAX_THREADS] = {};
+  uint64_t abandoned[MAX_THREADS] = {};
+  std::unordered_map<unsigned long long, std::chrono::steady_clock::time_point> last_sampled;  // by ctx
+  while (true) {
+    std::this_thread::sleep_for(POLL_INTERVAL);
+    const double budget = m_BudgetMs.load(std::memory_order_relaxed);
+    const double suspend_after = m_SuspendAfterMs.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < MAX_THREADS; i++) {
+      Heartbeat &heartbeat = s_Beats[i];
+      if (!heartbeat.used.load(std::memory_order_acquire)) {
+        continue;
+      }
+      // A callback that started between the two reads is looked at next time
+      const uint64_t beat = heartbeat.beat.load(std::memory_order_acquire);
+      const int64_t since = heartbeat.since.load(std::memory_order_acquire);
+      if (since == 0 || heartbeat.beat.load(std::memory_order_acquire) != beat) {
+        continue;
+      }
+      const double ms = static_cast<double>(now_ns() - since) / 1e6;
+      const auto callback = static_cast<FaultGuard::Callback>(heartbeat.callback.load(std::memory_order_relaxed));
+      const bool per_frame = callback == FaultGuard::Callback::Update || callback == FaultGuard::Callback::Draw ||
+          callback == FaultGuard::Callback::Mouse;
+      const double limit = per_frame ? budget : std::max(budget, LOAD_BUDGET_MS);
+
+      if (ms > limit && reported[i] != beat) {
+        reported[i] = beat;
+        m_HangCount++;
+        const unsigned long long ctx = heartbeat.ctx.load(std::memory_order_relaxed);
+        const auto now = std::chrono::steady_clock::now();
+        const auto last = last_sampled.find(ctx);
+        if (last == last_sampled.end() || now - last->second >= REPORT_INTERVAL) {
+          last_sampled[ctx] = now;
+          Hang hang = Sample(i, beat, ms);
+          // Printed from here, the thread it is about may never come back to print anything
+          std::cerr << "[Watchdog] " << FaultGuard::CallbackName(hang.callback) << " of ctx " << hang.ctx
+                    << " has been running for " << static_cast<int>(hang.ms) << " ms (budget "
+                    << static_cast<int>(limit) << " ms)" << (hang.stack.empty() ? ", no stack sample" : ":")
+                    << std::endl;
+          for (size_t frame = 0; frame < hang.stack.size(); frame++) {
+            std::cerr << "  #" << frame << " " << hang.stack[frame] << std::endl;
+          }
+          std::lock_guard lock(m_HangsMutex);
+          m_Hangs.push_back(std::move(hang));
+          if (m_Hangs.size() > MAX_HANGS) {
+            m_Hangs.pop_front();
+          }
+        }
+      }
+
+      // The last attempt landed while the thread held an allocator lock, try again now
+      const bool retry = abandoned[i] == beat && heartbeat.request.load(std::memory_order_acquire) == DEFERRED;
+      if (suspend_after > 0.0 && ms > std::max(limit, suspend_after) && (abandoned[i] != beat || retry)) {
+        if (!retry) {
+          abandoned[i] = beat;
+          std::cerr << "[Watchdog] Abandoning " << FaultGuard::CallbackName(callback) << " of ctx "
+                    << heartbeat.ctx.load(std::memory_order_relaxed) << " after " << static_cast<int>(ms) << " ms"
+                    << std::endl;
+        }
+        heartbeat.request_beat.store(beat, std::memory_order_relaxed);
+        heartbeat.request.store(ABANDON, std::memory_order_release);
+        pthread_kill(heartbeat.thread, watchdog_signal());
+      }
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "GaugeLoader/FaultGuard.hpp"
+
+// Catches gauge callbacks that don't return. FaultGuard::Run stamps a heartbeat for its thread when a callback starts
+// and clears it when it returns; a watchdog thread checks them every few ms. A callback running past its budget is
+// reported once per call with a stack sample taken on its thread, where it is stuck, so a hang no longer freezes the
+// emulator without a word. With suspension on, a callback still running past the suspend limit is abandoned through
+// FaultGuard as a HANG fault: the gauge keeps its last frame and isn't called again until it is reloaded. The callback
+// is interrupted wherever it is, the same caveats as a crash apply to locks it held, except the emulator's allocator
+// locks: inside those the abandon waits for the next poll.
+class Watchdog {
+  public:
+  static Watchdog *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new Watchdog();
+    }
+    return m_Instance;
+  }
+
+  // Main thread, after FaultGuard::Install
+  std::expected<void, std::string> Start();
+
+  // update, draw and mouse_handler, like the sim's per gauge frame budget. init, save_state and kill load and store
+  // whole databases, they only count once they run past LOAD_BUDGET_MS.
+  void SetBudget(double ms) { m_BudgetMs = ms; }
+  double GetBudget() const { return m_BudgetMs; }
+  static constexpr double LOAD_BUDGET_MS = 2000.0;
+  // 0 reports only. Never before the callback's budget, a slow init gets LOAD_BUDGET_MS at least.
+  void SetSuspendAfter(double ms) { m_SuspendAfterMs = ms; }
+  double GetSuspendAfter() const { return m_SuspendAfterMs; }
+
+  struct Hang {
+    unsigned long long ctx;
+    FaultGuard::Callback callback;
+    double ms;  // when the sample was taken
+    std::vector<std::string> stack;  // leaf first, empty when the thread didn't answer or the callback returned
+  };
+  // The most recent reports, oldest first
+  std::vector<Hang> GetRecentHangs() const;
+  uint64_t GetHangCount() const { return m_HangCount; }
+
+  // FaultGuard, around the outermost guarded callback of the calling thread
+  static void Beat(unsigned long long ctx, FaultGuard::Callback callback);
+  static void Rest();
+
+  // Nonzero while the thread holds one of the emulator's own locks (HeapTracker's arena locks). An abandon landing
+  // there is put off to the next poll instead of leaving the lock held for good. Constant initialized, malloc uses it.
+  static inline constinit thread_local int s_NoAbandon = 0;
+
+  private:
+  Watchdog() = default;
+  void Run();
+  Hang Sample(uint32_t slot, uint64_t beat, double ms);
+
+  static Watchdog *m_Instance;
+
+  bool m_Running = false;
+  std::atomic<double> m_BudgetMs{50.0};
+  std::atomic<double> m_SuspendAfterMs{0.0};
+  std::atomic<uint64_t> m_HangCount{0};
+  mutable std::mutex m_HangsMutex;
+  std::deque<Hang> m_Hangs;
+};
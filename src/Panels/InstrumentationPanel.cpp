@@ -0,0 +1,615 @@
+#include "InstrumentationPanel.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Application/Application.hpp"
+#include "Benchmark/BenchmarkReport.hpp"
+#include "Benchmark/NvgUserPtrBenchmark.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "GaugeLoader/Watchdog.hpp"
+#include "Profiling/HeapTracker.hpp"
+#include "Profiling/PerfCounters.hpp"
+#include "Profiling/SamplingProfiler.hpp"
+#include "Profiling/SimVarProfiler.hpp"
+#include "imgui.h"
+
+void InstrumentationPanel::Render() {
+  ImGui::Begin("Instrumentation");
+  RenderFramePacing();
+  RenderGaugeLoading();
+  RenderGaugeDrawing();
+  RenderSimVarAccess();
+  RenderSamplingProfiler();
+  RenderPerfCounters();
+  RenderGaugeHeaps();
+  RenderUpdateWorkers();
+  RenderWatchdog();
+  RenderEventQueue();
+  RenderBenchmarks();
+  ImGui::End();
+}
+
+void InstrumentationPanel::RenderGaugeLoading() {
+  if (!ImGui::CollapsingHeader("Gauge Loading")) {
+    return;
+  }
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool eager = gauge_loader->IsEagerBinding();
+  if (ImGui::Checkbox("Bind symbols at load (RTLD_NOW)", &eager)) {
+    gauge_loader->SetEagerBinding(eager);
+  }
+  ImGui::TextDisabled("Applies to the next load or reload");
+
+  const auto &gauges = gauge_loader->GetAllGauges();
+  for (const auto &[name, missing]: gauge_loader->GetMissingImports()) {
+    const auto gauge = gauges.find(name);
+    const char *isolation =
+        gauge != gauges.end() ? GaugeLinker::IsolationName(gauge->second.mount_params.isolation) : "?";
+    if (missing.empty()) {
+      ImGui::Text("%s (%s): all emulator imports resolved", name.c_str(), isolation);
+      continue;
+    }
+    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "%s (%s): %zu unresolved imports", name.c_str(), isolation,
+                       missing.size());
+    for (const auto &symbol: missing) {
+      ImGui::BulletText("%s", symbol.c_str());
+    }
+  }
+}
+
+void InstrumentationPanel::RenderGaugeDrawing() {
+  if (!ImGui::CollapsingHeader("Gauge Drawing")) {
+    return;
+  }
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool skip = gauge_loader->IsSkipUnchangedDraws();
+  if (ImGui::Checkbox("Skip draws when no read simvar changed", &skip)) {
+    gauge_loader->SetSkipUnchangedDraws(skip);
+  }
+  auto &stats = gauge_loader->GetDrawStats();
+  const uint64_t total = stats.drawn + stats.skipped;
+  ImGui::Text("Drawn: %llu  Skipped: %llu (%.1f%%)", static_cast<unsigned long long>(stats.drawn),
+              static_cast<unsigned long long>(stats.skipped),
+              total > 0 ? 100.0 * static_cast<double>(stats.skipped) / static_cast<double>(total) : 0.0);
+  ImGui::SameLine();
+  if (ImGui::SmallButton("Reset")) {
+    stats = {0, 0};
+  }
+
+  for (const auto &[name, gauge]: gauge_loader->GetAllGauges()) {
+    const GaugeDispatch *dispatch = gauge_loader->GetDispatch(gauge.dispatch);
+    if (!dispatch) {
+      continue;
+    }
+    if (dispatch->flags & GaugeDispatch::ALWAYS_REDRAW) {
+      ImGui::Text("%s: always_redraw", name.c_str());
+    } else {
+      ImGui::Text("%s: depends on %zu simvars", name.c_str(), dispatch->reads.variables.size());
+    }
+  }
+}
+
+void InstrumentationPanel::RenderSimVarAccess() {
+  if (!ImGui::CollapsingHeader("SimVar Access")) {
+    return;
+  }
+  SimVarProfiler *profiler = SimVarProfiler::GetInstance();
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool enabled = profiler->IsEnabled();
+  if (ImGui::Checkbox("Count fsVars gets and sets", &enabled)) {
+    profiler->SetEnabled(enabled);
+  }
+  ImGui::SameLine();
+  if (ImGui::SmallButton("Reset##SimVarAccess")) {
+    profiler->Reset();
+  }
+  const uint64_t frames = profiler->GetFrames();
+  ImGui::TextDisabled("%llu frames", static_cast<unsigned long long>(frames));
+
+  enum Column : ImGuiID { Gauge, Variable, Unit, Reads, PeakReads, Writes, PeakWrites };
+  static Column sort_column = Reads;
+  static bool sort_ascending = false;
+
+  const auto variable_name = [gauge_loader](const int id) -> std::string {
+    return static_cast<size_t>(id) < gauge_loader->GetVariableCount() ? gauge_loader->GetVariableName(id)
+                                                                       : "#" + std::to_string(id);
+  };
+
+  constexpr ImGuiTableFlags table_flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg |
+      ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable;
+  if (!ImGui::BeginTable("SimVarAccessTable", 7, table_flags, ImVec2(0.0f, 240.0f))) {
+    return;
+  }
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Gauge", ImGuiTableColumnFlags_WidthStretch, 0.0f, Gauge);
+  ImGui::TableSetupColumn("SimVar", ImGuiTableColumnFlags_WidthStretch, 0.0f, Variable);
+  ImGui::TableSetupColumn("Unit", ImGuiTableColumnFlags_WidthFixed, 0.0f, Unit);
+  ImGui::TableSetupColumn("Reads/frame", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_WidthFixed, 0.0f,
+                          Reads);
+  ImGui::TableSetupColumn("Peak", ImGuiTableColumnFlags_WidthFixed, 0.0f, PeakReads);
+  ImGui::TableSetupColumn("Writes/frame", ImGuiTableColumnFlags_WidthFixed, 0.0f, Writes);
+  ImGui::TableSetupColumn("Peak##Writes", ImGuiTableColumnFlags_WidthFixed, 0.0f, PeakWrites);
+  ImGui::TableHeadersRow();
+
+  if (ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs(); sort_specs && sort_specs->SpecsDirty) {
+    if (sort_specs->SpecsCount > 0) {
+      sort_column = static_cast<Column>(sort_specs->Specs[0].ColumnUserID);
+      sort_ascending = sort_specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+    }
+    sort_specs->SpecsDirty = false;
+  }
+
+  // Counts change every frame, so the rows are re-sorted every frame. Names are looked up once per row, not per
+  // comparison.
+  struct NamedRow {
+    SimVarProfiler::Row row;
+    std::string gauge;
+    std::string variable;
+  };
+  const auto profiled = profiler->GetRows();
+  std::vector<NamedRow> rows;
+  rows.reserve(profiled.size());
+  for (const auto &row: profiled) {
+    rows.push_back(NamedRow{row, gauge_loader->GetGaugeName(row.ctx), variable_name(row.variable)});
+  }
+  std::ranges::sort(rows, [&](const NamedRow &left, const NamedRow &right) {
+    const auto &a = sort_ascending ? left : right;
+    const auto &b = sort_ascending ? right : left;
+    switch (sort_column) {
+      case Gauge:
+        return a.gauge < b.gauge;
+      case Variable:
+        return a.variable < b.variable;
+      case Unit:
+        return a.row.unit < b.row.unit;
+      case PeakReads:
+        return a.row.peak_reads < b.row.peak_reads;
+      case Writes:
+        return a.row.writes < b.row.writes;
+      case PeakWrites:
+        return a.row.peak_writes < b.row.peak_writes;
+      case Reads:
+        break;
+    }
+    return a.row.reads < b.row.reads;
+  });
+
+  const double frame_count = static_cast<double>(std::max<uint64_t>(frames, 1));
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(rows.size()));
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &[row, gauge, variable] = rows[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(gauge.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(variable.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", row.unit);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(row.reads) / frame_count);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(row.peak_reads));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", static_cast<double>(row.writes) / frame_count);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(row.peak_writes));
+    }
+  }
+  ImGui::EndTable();
+}
+
+void InstrumentationPanel::RenderSamplingProfiler() {
+  if (!ImGui::CollapsingHeader("Sampling Profiler")) {
+    return;
+  }
+  SamplingProfiler *profiler = SamplingProfiler::GetInstance();
+
+  static int frequency = 1000;
+  static std::string error;
+  if (profiler->IsRunning()) {
+    if (ImGui::Button("Stop")) {
+      profiler->Stop();
+    }
+  } else {
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::SliderInt("Hz", &frequency, 100, 5000);
+    ImGui::SameLine();
+    if (ImGui::Button("Start")) {
+      auto started = profiler->Start(frequency);
+      error = started.has_value() ? "" : started.error();
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset##Sampling")) {
+    profiler->Reset();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Write collapsed stacks")) {
+    auto written = profiler->WriteCollapsed("gauge_profile.folded");
+    error = written.has_value() ? "" : written.error();
+  }
+  if (!error.empty()) {
+    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+  }
+
+  const uint64_t samples = profiler->GetSampleCount();
+  ImGui::Text("Samples in gauge code: %llu (dropped %llu)", static_cast<unsigned long long>(samples),
+              static_cast<unsigned long long>(profiler->GetDroppedCount()));
+  if (samples == 0) {
+    return;
+  }
+
+  constexpr ImGuiTableFlags table_flags =
+      ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable;
+  if (!ImGui::BeginTable("SamplingTable", 3, table_flags)) {
+    return;
+  }
+  ImGui::TableSetupColumn("Function", ImGuiTableColumnFlags_WidthStretch);
+  ImGui::TableSetupColumn("Self", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Total", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableHeadersRow();
+  const double scale = 100.0 / static_cast<double>(samples);
+  for (const auto &function: profiler->GetTopFunctions(25)) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(function.name.c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f%%", static_cast<double>(function.self) * scale);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f%%", static_cast<double>(function.total) * scale);
+  }
+  ImGui::EndTable();
+}
+
+void InstrumentationPanel::RenderPerfCounters() {
+  if (!ImGui::CollapsingHeader("Callback Counters")) {
+    return;
+  }
+  PerfCounters *counters = PerfCounters::GetInstance();
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool enabled = counters->IsEnabled();
+  if (ImGui::Checkbox("Count around update and draw (perf_event_open)", &enabled)) {
+    counters->SetEnabled(enabled);
+  }
+  ImGui::SameLine();
+  if (ImGui::SmallButton("Reset##PerfCounters")) {
+    counters->Reset();
+  }
+
+  const auto mode = counters->GetMode();
+  switch (mode) {
+    case PerfCounters::Mode::Unknown:
+      ImGui::TextDisabled("Counters are opened on the first measured callback");
+      break;
+    case PerfCounters::Mode::Hardware:
+      ImGui::TextDisabled("Hardware counters, user space only");
+      break;
+    case PerfCounters::Mode::Software:
+      ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "No PMU, showing software counters per call");
+      break;
+    case PerfCounters::Mode::Unavailable:
+      ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "perf_event_open unavailable, wall time only");
+      break;
+  }
+
+  auto rows = counters->GetRows();
+  std::ranges::sort(rows, [](const PerfCounters::Row &a, const PerfCounters::Row &b) {
+    return a.totals.wall_ns > b.totals.wall_ns;
+  });
+
+  // Hardware: IPC and misses per thousand instructions; software: every counter per call
+  const auto &names = PerfCounters::CounterNames(mode);
+  const char *headers[3] = {"IPC", "Cache MPKI", "Branch MPKI"};
+  const int extra_columns = mode == PerfCounters::Mode::Hardware ? 3 : mode == PerfCounters::Mode::Software ? 4 : 0;
+  constexpr ImGuiTableFlags table_flags =
+      ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable;
+  if (!ImGui::BeginTable("PerfCountersTable", 4 + extra_columns, table_flags)) {
+    return;
+  }
+  ImGui::TableSetupColumn("Gauge", ImGuiTableColumnFlags_WidthStretch);
+  ImGui::TableSetupColumn("Callback", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Wall us/call", ImGuiTableColumnFlags_WidthFixed);
+  for (int i = 0; i < extra_columns; i++) {
+    ImGui::TableSetupColumn(mode == PerfCounters::Mode::Hardware ? headers[i] : names[i],
+                            ImGuiTableColumnFlags_WidthFixed);
+  }
+  ImGui::TableHeadersRow();
+
+  for (const auto &row: rows) {
+    const auto calls = static_cast<double>(std::max<uint64_t>(row.totals.calls, 1));
+    const auto &values = row.totals.values;
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(gauge_loader->GetGaugeName(row.ctx).c_str());
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(PerfCounters::CallbackName(row.callback));
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(row.totals.calls));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", row.totals.wall_ns / calls / 1000.0);
+
+    if (mode == PerfCounters::Mode::Hardware) {
+      const double ratios[3] = {values[0] > 0.0 ? values[1] / values[0] : 0.0,
+                                values[1] > 0.0 ? values[2] / values[1] * 1000.0 : 0.0,
+                                values[1] > 0.0 ? values[3] / values[1] * 1000.0 : 0.0};
+      const bool available[3] = {counters->IsCounterAvailable(1), counters->IsCounterAvailable(2),
+                                 counters->IsCounterAvailable(3)};
+      for (int i = 0; i < 3; i++) {
+        ImGui::TableNextColumn();
+        if (available[i]) {
+          ImGui::Text("%.2f", ratios[i]);
+        } else {
+          ImGui::TextDisabled("n/a");
+        }
+      }
+    } else if (mode == PerfCounters::Mode::Software) {
+      for (int i = 0; i < 4; i++) {
+        ImGui::TableNextColumn();
+        if (counters->IsCounterAvailable(i)) {
+          ImGui::Text("%.1f", values[i] / calls);
+        } else {
+          ImGui::TextDisabled("n/a");
+        }
+      }
+    }
+  }
+  ImGui::EndTable();
+}
+
+void InstrumentationPanel::RenderGaugeHeaps() {
+  if (!ImGui::CollapsingHeader("Gauge Heaps")) {
+    return;
+  }
+  HeapTracker *heaps = HeapTracker::GetInstance();
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool arena_heaps = gauge_loader->IsArenaHeaps();
+  if (ImGui::Checkbox("Arena heaps for every gauge (from the next load)", &arena_heaps)) {
+    gauge_loader->SetArenaHeaps(arena_heaps);
+  }
+  if (ImGui::SmallButton("Reset peaks##GaugeHeaps")) {
+    heaps->Reset();
+  }
+  ImGui::SameLine();
+  ImGui::TextDisabled("Allocations made inside gauge callbacks, limits in MiB (0 = none)");
+
+  constexpr ImGuiTableFlags table_flags =
+      ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable;
+  if (!ImGui::BeginTable("GaugeHeapsTable", 9, table_flags)) {
+    return;
+  }
+  ImGui::TableSetupColumn("Gauge", ImGuiTableColumnFlags_WidthStretch);
+  ImGui::TableSetupColumn("Live KiB", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Blocks", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Peak KiB", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Allocs/frame", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("KiB/frame (peak)", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Refused", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Arena KiB", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableSetupColumn("Limit", ImGuiTableColumnFlags_WidthFixed);
+  ImGui::TableHeadersRow();
+
+  for (const auto &row: heaps->GetRows()) {
+    ImGui::PushID(static_cast<int>(row.ctx));
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(gauge_loader->GetGaugeName(row.ctx).c_str());
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", static_cast<double>(row.live_bytes) / 1024.0);
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu", static_cast<unsigned long long>(row.live_blocks));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", static_cast<double>(row.peak_bytes) / 1024.0);
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu (%llu)", static_cast<unsigned long long>(row.frame_allocs),
+                static_cast<unsigned long long>(row.peak_frame_allocs));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f (%.1f)", static_cast<double>(row.frame_bytes) / 1024.0,
+                static_cast<double>(row.peak_frame_bytes) / 1024.0);
+    ImGui::TableNextColumn();
+    if (row.failed_allocs > 0) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%llu", static_cast<unsigned long long>(row.failed_allocs));
+    } else {
+      ImGui::TextDisabled("0");
+    }
+    ImGui::TableNextColumn();
+    if (row.arena) {
+      ImGui::Text("%.0f", static_cast<double>(row.arena_bytes) / 1024.0);
+    } else {
+      ImGui::TextDisabled("-");
+    }
+    ImGui::TableNextColumn();
+    int limit_mb = static_cast<int>(row.limit_bytes / (1024 * 1024));
+    ImGui::SetNextItemWidth(80.0f);
+    if (ImGui::InputInt("##limit", &limit_mb, 0, 0, ImGuiInputTextFlags_EnterReturnsTrue)) {
+      heaps->SetLimit(row.ctx, static_cast<size_t>(std::max(limit_mb, 0)) * 1024 * 1024);
+    }
+    ImGui::PopID();
+  }
+  ImGui::EndTable();
+}
+
+void InstrumentationPanel::RenderUpdateWorkers() {
+  if (!ImGui::CollapsingHeader("Gauge Update Workers", ImGuiTreeNodeFlags_DefaultOpen)) {
+    return;
+  }
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  bool force_serial = gauge_loader->IsForceSerialUpdate();
+  if (ImGui::Checkbox("Force serial updates", &force_serial)) {
+    gauge_loader->SetForceSerialUpdate(force_serial);
+  }
+  ImGui::Text("UpdateGauges: %.3f ms", gauge_loader->GetLastUpdateTime());
+
+  WorkerPool *pool = gauge_loader->GetUpdatePool();
+  if (!pool) {
+    ImGui::TextDisabled("No gauge has parallel_update enabled");
+    return;
+  }
+
+  // Utilization is sampled every frame, smooth it so the bars are readable
+  static std::vector<float> smoothed;
+  const auto stats = pool->SampleStats();
+  smoothed.resize(stats.size(), 0.0f);
+
+  char label[64];
+  for (size_t i = 0; i < stats.size(); ++i) {
+    smoothed[i] = smoothed[i] * 0.9f + static_cast<float>(stats[i].utilization) * 0.1f;
+    const bool is_caller = i + 1 == stats.size();
+    std::snprintf(label, sizeof(label), "%s %zu: %.1f%% (%llu tasks, %llu steals)", is_caller ? "Main" : "Worker", i,
+                  smoothed[i] * 100.0f, static_cast<unsigned long long>(stats[i].tasks),
+                  static_cast<unsigned long long>(stats[i].steals));
+    ImGui::ProgressBar(smoothed[i], ImVec2(-1.0f, 0.0f), label);
+  }
+}
+
+void InstrumentationPanel::RenderWatchdog() {
+  if (!ImGui::CollapsingHeader("Gauge Watchdog")) {
+    return;
+  }
+  Watchdog *watchdog = Watchdog::GetInstance();
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  int budget = static_cast<int>(watchdog->GetBudget());
+  if (ImGui::SliderInt("Budget (ms)", &budget, 1, 1000)) {
+    watchdog->SetBudget(budget);
+  }
+  // Remembered while suspension is off, so toggling it doesn't lose the limit
+  static int suspend_after = 2000;
+  bool suspend = watchdog->GetSuspendAfter() > 0.0;
+  if (ImGui::Checkbox("Suspend gauges stuck in a callback", &suspend)) {
+    watchdog->SetSuspendAfter(suspend ? suspend_after : 0.0);
+  }
+  if (suspend && ImGui::SliderInt("After (ms)", &suspend_after, 100, 10000)) {
+    watchdog->SetSuspendAfter(suspend_after);
+  }
+  ImGui::TextDisabled("init, save_state and kill get %.0f ms at least", Watchdog::LOAD_BUDGET_MS);
+
+  const auto hangs = watchdog->GetRecentHangs();
+  ImGui::Text("Over budget: %llu", static_cast<unsigned long long>(watchdog->GetHangCount()));
+  if (hangs.empty()) {
+    return;
+  }
+  char label[256];
+  for (auto it = hangs.rbegin(); it != hangs.rend(); ++it) {
+    const std::string gauge = gauge_loader->GetGaugeName(it->ctx);
+    std::snprintf(label, sizeof(label), "%s %s: %.0f ms", gauge.c_str(), FaultGuard::CallbackName(it->callback),
+                  it->ms);
+    ImGui::PushID(static_cast<int>(it - hangs.rbegin()));
+    if (ImGui::TreeNode(label)) {
+      for (const auto &frame: it->stack) {
+        ImGui::BulletText("%s", frame.c_str());
+      }
+      if (it->stack.empty()) {
+        ImGui::TextDisabled("No stack sample");
+      }
+      ImGui::TreePop();
+    }
+    ImGui::PopID();
+  }
+}
+
+void InstrumentationPanel::RenderEventQueue() {
+  if (!ImGui::CollapsingHeader("Main Thread Event Queue")) {
+    return;
+  }
+  const auto stats = Application::Get().value()->GetEventQueue().GetStats();
+
+  ImGui::Text("Depth: %zu / %zu (peak %zu)", stats.depth, stats.capacity, stats.max_depth);
+  ImGui::Text("Enqueued: %llu  Executed: %llu", static_cast<unsigned long long>(stats.enqueued),
+              static_cast<unsigned long long>(stats.executed));
+  ImGui::Text("Enqueue cost: avg %.0f ns, max %.0f ns", stats.avg_enqueue_ns, stats.max_enqueue_ns);
+  ImGui::Text("Queue wait: avg %.1f us, max %.1f us", stats.avg_wait_us, stats.max_wait_us);
+  ImGui::Text("Full retries: %llu  Heap captures: %llu", static_cast<unsigned long long>(stats.full_retries),
+              static_cast<unsigned long long>(stats.heap_events));
+}
+
+void InstrumentationPanel::RenderFramePacing() {
+  if (!ImGui::CollapsingHeader("Frame Pacing", ImGuiTreeNodeFlags_DefaultOpen)) {
+    return;
+  }
+  Application *app = Application::Get().value();
+  FramePacer &pacer = app->GetFramePacer();
+
+  bool idle = app->IsIdleRendering();
+  if (ImGui::Checkbox("Idle when nothing changes", &idle)) {
+    app->SetIdleRendering(idle);
+  }
+  if (idle) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("%llu frames, %llu idle wakeups", static_cast<unsigned long long>(app->GetRenderedFrames()),
+                        static_cast<unsigned long long>(app->GetIdleWakeups()));
+  }
+
+  static constexpr FramePacer::Mode modes[] = {FramePacer::Mode::VSync, FramePacer::Mode::Uncapped,
+                                               FramePacer::Mode::FixedCap, FramePacer::Mode::Latency};
+  if (ImGui::BeginCombo("Mode", FramePacer::ModeName(pacer.GetMode()))) {
+    for (const auto mode: modes) {
+      if (ImGui::Selectable(FramePacer::ModeName(mode), mode == pacer.GetMode())) {
+        pacer.SetMode(mode);
+      }
+    }
+    ImGui::EndCombo();
+  }
+  if (pacer.GetMode() == FramePacer::Mode::FixedCap) {
+    int fps = pacer.GetTargetFps();
+    if (ImGui::SliderInt("Target FPS", &fps, FramePacer::MIN_TARGET_FPS, FramePacer::MAX_TARGET_FPS)) {
+      pacer.SetTargetFps(fps);
+    }
+  }
+
+  const auto stats = pacer.GetStats();
+  ImGui::Text("Frame: %.3f ms mean, %.3f ms stddev (%llu frames)", stats.mean_ms, stats.stddev_ms,
+              static_cast<unsigned long long>(stats.frames));
+  if (stats.target_ms > 0.0) {
+    ImGui::Text("Target: %.3f ms, worst late: %.3f ms", stats.target_ms, stats.worst_late_ms);
+  }
+  ImGui::Text("Spin window: %.3f ms, predicted work: %.3f ms", stats.spin_threshold_ms, stats.predicted_work_ms);
+
+  const auto &frame_times = pacer.GetFrameTimes();
+  ImGui::PlotLines("##FrameTimes", frame_times.data(), static_cast<int>(frame_times.size()),
+                   static_cast<int>(pacer.GetFrameTimesOffset()), "Frame time (ms)", 0.0f,
+                   static_cast<float>(std::max(stats.target_ms, stats.mean_ms) * 2.0), ImVec2(-1.0f, 60.0f));
+
+  const auto &histogram = pacer.GetJitterHistogram();
+  ImGui::PlotHistogram("##Jitter", histogram.data(), static_cast<int>(histogram.size()), 0,
+                       "Deviation from target, -2ms .. +2ms", 0.0f, 3.4e38f, ImVec2(-1.0f, 80.0f));
+  if (ImGui::Button("Reset pacing stats")) {
+    pacer.ResetStats();
+  }
+}
+
+void InstrumentationPanel::RenderBenchmarks() {
+  if (!ImGui::CollapsingHeader("Benchmarks")) {
+    return;
+  }
+  BenchmarkReport *report = BenchmarkReport::GetInstance();
+
+  if (ImGui::Button("NanoVG user pointer lookup")) {
+    NvgUserPtrBenchmark::Run(*report);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Export JSON")) {
+    SimVarProfiler::GetInstance()->Export(*report);
+    PerfCounters::GetInstance()->Export(*report);
+    HeapTracker::GetInstance()->Export(*report);
+    if (auto result = report->WriteJson("benchmark_report.json"); !result.has_value()) {
+      std::cerr << "Error exporting benchmarks: " << result.error() << std::endl;
+    }
+  }
+
+  for (const auto &result: report->GetResults()) {
+    ImGui::Text("%s: %.3f %s", result.name.c_str(), result.value, result.unit.c_str());
+  }
+}
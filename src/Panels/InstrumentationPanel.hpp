@@ -0,0 +1,20 @@
+#pragma once
+
+// Runtime statistics window, each subsystem that exposes counters gets its own collapsible section here
+class InstrumentationPanel {
+  public:
+  static void Render();
+
+  private:
+  static void RenderGaugeLoading();
+  static void RenderGaugeDrawing();
+  static void RenderSimVarAccess();
+  static void RenderSamplingProfiler();
+  static void RenderPerfCounters();
+  static void RenderGaugeHeaps();
+  static void RenderUpdateWorkers();
+  static void RenderWatchdog();
+  static void RenderEventQueue();
+  static void RenderFramePacing();
+  static void RenderBenchmarks();
+};
@@ -0,0 +1,187 @@
+#include "PlotPanel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "imgui.h"
+
+static constexpr VariableHistory::Range EMPTY_RANGE{std::numeric_limits<float>::max(),
+                                                    std::numeric_limits<float>::lowest()};
+
+static constexpr double WINDOWS[] = {10.0, 60.0, 600.0};
+static constexpr const char *WINDOW_NAMES[] = {"10 s", "60 s", "10 min"};
+static constexpr float PLOT_HEIGHT = 70.0f;
+
+VariableHistory::VariableHistory()
+    : m_Fine{FINE_PERIOD, std::vector<Range>(FINE_BUCKETS, EMPTY_RANGE)}
+    , m_Coarse{COARSE_PERIOD, std::vector<Range>(COARSE_BUCKETS, EMPTY_RANGE)} {}
+
+void VariableHistory::Ring::Sample(double time, float value) {
+  const auto bucket = static_cast<int64_t>(std::floor(time / period));
+  const auto size = static_cast<int64_t>(buckets.size());
+  if (bucket > head) {
+    // Clear the buckets we skipped over (idle frames), at most one full lap
+    const int64_t first = std::max(head + 1, bucket - size + 1);
+    for (int64_t i = first; i <= bucket; ++i) {
+      buckets[i % size] = EMPTY_RANGE;
+    }
+    head = bucket;
+  } else if (bucket <= head - size) {
+    return;
+  }
+  Range &range = buckets[bucket % size];
+  range.min = std::min(range.min, value);
+  range.max = std::max(range.max, value);
+}
+
+VariableHistory::Range VariableHistory::Ring::Get(int64_t bucket) const {
+  const auto size = static_cast<int64_t>(buckets.size());
+  if (bucket > head || bucket <= head - size || bucket < 0) {
+    return EMPTY_RANGE;
+  }
+  return buckets[bucket % size];
+}
+
+void VariableHistory::Sample(double time, double value) {
+  const auto sample = static_cast<float>(value);
+  m_Fine.Sample(time, sample);
+  m_Coarse.Sample(time, sample);
+}
+
+void VariableHistory::Decimate(double now, double window, std::vector<Range> &out) const {
+  std::ranges::fill(out, EMPTY_RANGE);
+  if (out.empty()) {
+    return;
+  }
+  const Ring &ring = window / m_Fine.period <= static_cast<double>(m_Fine.buckets.size()) ? m_Fine : m_Coarse;
+
+  const auto last = static_cast<int64_t>(std::floor(now / ring.period));
+  const int64_t first = last - static_cast<int64_t>(std::ceil(window / ring.period)) + 1;
+  const auto columns = static_cast<double>(out.size());
+  const double buckets = static_cast<double>(last - first + 1);
+
+  for (int64_t bucket = std::max(first, ring.head - static_cast<int64_t>(ring.buckets.size()) + 1);
+       bucket <= std::min(last, ring.head); ++bucket) {
+    const Range range = ring.Get(bucket);
+    if (range.IsEmpty()) {
+      continue;
+    }
+    const auto column =
+        std::min(static_cast<size_t>(static_cast<double>(bucket - first) / buckets * columns), out.size() - 1);
+    out[column].min = std::min(out[column].min, range.min);
+    out[column].max = std::max(out[column].max, range.max);
+  }
+}
+
+PlotPanel::~PlotPanel() {
+  for (const auto &pinned: m_Pinned) {
+    GaugeLoader::GetInstance()->Unsubscribe(pinned.subscription);
+  }
+}
+
+void PlotPanel::Sample(double time) {
+  // Every value written since the last frame, so a gauge that sets a variable several times per update still shows
+  // its extremes
+  for (const auto &[id, value]: m_Changes) {
+    if (const auto it = std::ranges::find(m_Pinned, id, &PinnedVariable::id); it != m_Pinned.end()) {
+      it->history.Sample(time, value);
+    }
+  }
+  m_Changes.clear();
+
+  // Unchanged variables still need a sample per frame to draw a continuous line
+  auto gauge_loader = GaugeLoader::GetInstance();
+  for (auto &pinned: m_Pinned) {
+    pinned.history.Sample(time, gauge_loader->GetVariable(pinned.id));
+  }
+}
+
+void PlotPanel::TogglePin(int id) {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  if (const auto it = std::ranges::find(m_Pinned, id, &PinnedVariable::id); it != m_Pinned.end()) {
+    gauge_loader->Unsubscribe(it->subscription);
+    m_Pinned.erase(it);
+    return;
+  }
+  const uint64_t subscription =
+      gauge_loader->Subscribe(id, [this](int changed, double value) { m_Changes.emplace_back(changed, value); });
+  m_Pinned.push_back(PinnedVariable{id, subscription, VariableHistory()});
+}
+
+bool PlotPanel::IsPinned(int id) const {
+  return std::ranges::find(m_Pinned, id, &PinnedVariable::id) != m_Pinned.end();
+}
+
+void PlotPanel::Render(double time) {
+  if (m_Pinned.empty()) {
+    return;
+  }
+  ImGui::Begin("SimVar Plots");
+  ImGui::SetNextItemWidth(120.0f);
+  ImGui::Combo("Window", &m_WindowIndex, WINDOW_NAMES, IM_ARRAYSIZE(WINDOW_NAMES));
+
+  int unpin = -1;
+  for (const auto &pinned: m_Pinned) {
+    ImGui::PushID(pinned.id);
+    if (ImGui::SmallButton("Unpin")) {
+      unpin = pinned.id;
+    }
+    ImGui::SameLine();
+    RenderPlot(pinned, time);
+    ImGui::PopID();
+  }
+  if (unpin >= 0) {
+    TogglePin(unpin);
+  }
+  ImGui::End();
+}
+
+void PlotPanel::RenderPlot(const PinnedVariable &pinned, double time) {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  const double window = WINDOWS[m_WindowIndex];
+
+  const float width = std::max(ImGui::GetContentRegionAvail().x, 50.0f);
+  m_Columns.resize(static_cast<size_t>(width));
+  pinned.history.Decimate(time, window, m_Columns);
+
+  float low = std::numeric_limits<float>::max();
+  float high = std::numeric_limits<float>::lowest();
+  for (const auto &column: m_Columns) {
+    if (!column.IsEmpty()) {
+      low = std::min(low, column.min);
+      high = std::max(high, column.max);
+    }
+  }
+  ImGui::Text("%s = %.4f", gauge_loader->GetVariableName(pinned.id).c_str(), gauge_loader->GetVariable(pinned.id));
+  if (low > high) {
+    ImGui::TextDisabled("no samples yet");
+    return;
+  }
+  ImGui::SameLine();
+  ImGui::TextDisabled("[%.4f .. %.4f]", low, high);
+
+  const ImVec2 top_left = ImGui::GetCursorScreenPos();
+  const ImVec2 bottom_right(top_left.x + width, top_left.y + PLOT_HEIGHT);
+  ImGui::Dummy(ImVec2(width, PLOT_HEIGHT));
+
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  draw_list->AddRectFilled(top_left, bottom_right, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+  // Flat signals still get a visible line in the middle
+  const float span = high - low > 1e-9f ? high - low : 1.0f;
+  const float center_offset = high - low > 1e-9f ? 0.0f : PLOT_HEIGHT * 0.5f;
+  const ImU32 color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+  for (size_t x = 0; x < m_Columns.size(); ++x) {
+    const auto &column = m_Columns[x];
+    if (column.IsEmpty()) {
+      continue;
+    }
+    const float px = top_left.x + static_cast<float>(x) + 0.5f;
+    const float y_min = bottom_right.y - (column.min - low) / span * PLOT_HEIGHT - center_offset;
+    const float y_max = bottom_right.y - (column.max - low) / span * PLOT_HEIGHT - center_offset;
+    // A column with min == max would be zero pixels tall, stretch it to one
+    draw_list->AddLine(ImVec2(px, y_min + 0.5f), ImVec2(px, y_max - 0.5f), color);
+  }
+}
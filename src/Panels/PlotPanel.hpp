@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Fixed size value history of one variable. Samples are folded into min/max buckets at two resolutions, a fine ring for
+// the last minute and a coarse one for the last ten minutes, so memory is constant and drawing a window never touches
+// more buckets than the plot has pixels (give or take).
+class VariableHistory {
+  public:
+  static constexpr double FINE_PERIOD = 0.05;
+  static constexpr int FINE_BUCKETS = 1200;  // 60 s
+  static constexpr double COARSE_PERIOD = 1.0;
+  static constexpr int COARSE_BUCKETS = 600;  // 10 min
+
+  struct Range {
+    float min;
+    float max;
+    bool IsEmpty() const { return min > max; }
+  };
+
+  VariableHistory();
+
+  void Sample(double time, double value);
+  // Splits [now - window, now] into out.size() columns and fills each with the min/max that landed in it
+  void Decimate(double now, double window, std::vector<Range> &out) const;
+
+  private:
+  struct Ring {
+    double period;
+    std::vector<Range> buckets;
+    int64_t head = -1;  // absolute bucket number (time / period) of the newest bucket
+
+    void Sample(double time, float value);
+    Range Get(int64_t bucket) const;
+  };
+
+  private:
+  Ring m_Fine;
+  Ring m_Coarse;
+};
+
+// "SimVar Plots" window: scrolling min/max plots of every simvar pinned from the SimVars panel
+class PlotPanel {
+  public:
+  PlotPanel() = default;
+  PlotPanel(const PlotPanel &) = delete;
+  PlotPanel &operator=(const PlotPanel &) = delete;
+  ~PlotPanel();
+
+  void Sample(double time);
+  void Render(double time);
+
+  void TogglePin(int id);
+  bool IsPinned(int id) const;
+
+  private:
+  struct PinnedVariable {
+    int id;
+    uint64_t subscription;
+    VariableHistory history;
+  };
+
+  void RenderPlot(const PinnedVariable &pinned, double time);
+
+  private:
+  std::vector<PinnedVariable> m_Pinned;
+  std::vector<VariableHistory::Range> m_Columns;  // decimation scratch
+  std::vector<std::pair<int, double>> m_Changes;  // <id, value> written to a pinned variable since the last Sample
+  int m_WindowIndex = 1;
+};
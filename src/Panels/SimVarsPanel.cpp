@@ -0,0 +1,173 @@
+#include "SimVarsPanel.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "PlotPanel.hpp"
+#include "imgui.h"
+
+void SimVarsPanel::Render() {
+  ImGui::Begin("SimVars");
+  SyncVariables();
+
+  auto gauge_loader = GaugeLoader::GetInstance();
+
+  ImGui::SetNextItemWidth(-1.0f);
+  if (ImGui::InputTextWithHint("##Search", "Search simvars", m_Search, sizeof(m_Search))) {
+    m_SortByRelevance = m_Search[0] != '\0';
+    RebuildRows();
+  }
+  if (m_Search[0] != '\0') {
+    ImGui::TextDisabled("%zu matches of %zu in %.0f us", m_Rows.size(), gauge_loader->GetVariableIndex().GetSize(),
+                        m_SearchMicros);
+  } else {
+    ImGui::TextDisabled("%zu variables", m_Rows.size());
+  }
+
+  constexpr ImGuiTableFlags table_flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg |
+      ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable;
+  if (ImGui::BeginTable("SimVarTable", 4, table_flags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_WidthFixed, 0.0f,
+                            static_cast<ImGuiID>(SortColumn::Id));
+    ImGui::TableSetupColumn("SimVar Name", ImGuiTableColumnFlags_WidthStretch, 0.0f,
+                            static_cast<ImGuiID>(SortColumn::Name));
+    ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch, 0.0f, static_cast<ImGuiID>(SortColumn::Value));
+    ImGui::TableSetupColumn("", ImGuiTableColumnFlags_NoSort | ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+
+    if (ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs(); sort_specs && sort_specs->SpecsDirty) {
+      if (sort_specs->SpecsCount > 0) {
+        m_SortColumn = static_cast<SortColumn>(sort_specs->Specs[0].ColumnUserID);
+        m_SortAscending = sort_specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+      }
+      m_SortByRelevance = false;
+      SortRows();
+      sort_specs->SpecsDirty = false;
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(m_Rows.size()));
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+        const int id = m_Rows[row];
+        auto &config = m_Configs[id];
+        ImGui::PushID(id);
+        ImGui::TableNextRow();
+
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", id);
+
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(gauge_loader->GetVariableName(id).c_str());
+
+        ImGui::TableNextColumn();
+        auto value = static_cast<float>(gauge_loader->GetVariable(id));
+        ImGui::SetNextItemWidth(-1.0f);
+        if (ImGui::SliderFloat("##Value", &value, config.min, config.max, "%.3f")) {
+          gauge_loader->UpdateVariable(id, value);
+        }
+
+        ImGui::TableNextColumn();
+        if (ImGui::SmallButton(m_PlotPanel.IsPinned(id) ? "Unpin" : "Pin")) {
+          m_PlotPanel.TogglePin(id);
+        }
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Config")) {
+          config.show_config = !config.show_config;
+          if (config.show_config) {
+            if (config.config_title.empty()) {
+              config.config_title = "Config##Window_" + gauge_loader->GetVariableName(id);
+            }
+            m_OpenConfigs.push_back(id);
+          }
+        }
+        ImGui::PopID();
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+
+  RenderConfigWindows();
+}
+
+void SimVarsPanel::SyncVariables() {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  const uint64_t revision = gauge_loader->GetVariableIndex().GetRevision();
+  if (revision == m_IndexRevision) {
+    return;
+  }
+  m_IndexRevision = revision;
+  m_Configs.resize(gauge_loader->GetVariableCount());
+  RebuildRows();
+}
+
+void SimVarsPanel::RebuildRows() {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  m_Rows.clear();
+
+  if (m_Search[0] == '\0') {
+    for (int id = 0; id < static_cast<int>(gauge_loader->GetVariableCount()); ++id) {
+      if (gauge_loader->IsVariableRegistered(id)) {
+        m_Rows.push_back(id);
+      }
+    }
+    SortRows();
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  gauge_loader->GetVariableIndex().Query(m_Search, m_Matches);
+  m_SearchMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+  m_Rows.reserve(m_Matches.size());
+  for (const auto &match: m_Matches) {
+    m_Rows.push_back(match.id);
+  }
+  if (!m_SortByRelevance) {
+    SortRows();
+  }
+}
+
+void SimVarsPanel::SortRows() {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  const bool ascending = m_SortAscending;
+  switch (m_SortColumn) {
+    case SortColumn::Id:
+      std::ranges::sort(m_Rows, [ascending](int a, int b) { return ascending ? a < b : a > b; });
+      break;
+    case SortColumn::Name:
+      std::ranges::sort(m_Rows, [gauge_loader, ascending](int a, int b) {
+        const auto &index = gauge_loader->GetVariableIndex();
+        return ascending ? index.GetKey(a) < index.GetKey(b) : index.GetKey(a) > index.GetKey(b);
+      });
+      break;
+    case SortColumn::Value:
+      // Sorted on demand only, rows don't jump around while values change
+      std::ranges::sort(m_Rows, [gauge_loader, ascending](int a, int b) {
+        const double value_a = gauge_loader->GetVariable(a);
+        const double value_b = gauge_loader->GetVariable(b);
+        return ascending ? value_a < value_b : value_a > value_b;
+      });
+      break;
+  }
+}
+
+void SimVarsPanel::RenderConfigWindows() {
+  for (size_t i = 0; i < m_OpenConfigs.size();) {
+    auto &config = m_Configs[m_OpenConfigs[i]];
+    if (config.show_config) {
+      ImGui::Begin(config.config_title.c_str(), &config.show_config);
+      ImGui::InputFloat("Min", &config.min);
+      ImGui::InputFloat("Max", &config.max);
+      ImGui::End();
+    }
+    if (!config.show_config) {
+      m_OpenConfigs.erase(m_OpenConfigs.begin() + static_cast<long>(i));
+      continue;
+    }
+    ++i;
+  }
+}
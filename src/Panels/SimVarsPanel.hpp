@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Search/TrigramIndex.hpp"
+
+class PlotPanel;
+
+// Table of every registered simvar. Only the rows in view are submitted (ImGuiListClipper), widget ids come from the
+// variable id and the row list is only rebuilt when the search, sort order or variable set changes, so a frame costs
+// O(visible rows) and allocates nothing. Searching goes through the loader's trigram index and lists matches by
+// relevance until a column header is clicked.
+class SimVarsPanel {
+  public:
+  explicit SimVarsPanel(PlotPanel &plot_panel)
+      : m_PlotPanel(plot_panel) {}
+
+  void Render();
+
+  private:
+  struct VariableConfig {
+    float min = -100.0f;
+    float max = 100.0f;
+    bool show_config = false;
+    std::string config_title;  // built once when the config window is first opened
+  };
+
+  enum class SortColumn { Id, Name, Value };
+
+  void SyncVariables();
+  void RebuildRows();
+  void SortRows();
+  void RenderConfigWindows();
+
+  private:
+  PlotPanel &m_PlotPanel;
+  std::vector<VariableConfig> m_Configs;  // indexed by variable id
+  std::vector<int> m_Rows;  // filtered and sorted variable ids
+  std::vector<int> m_OpenConfigs;
+  std::vector<TrigramIndex::Match> m_Matches;
+  uint64_t m_IndexRevision = ~0ull;
+
+  char m_Search[128] = {};
+  double m_SearchMicros = 0.0;
+
+  SortColumn m_SortColumn = SortColumn::Id;
+  bool m_SortAscending = true;
+  bool m_SortByRelevance = false;
+};
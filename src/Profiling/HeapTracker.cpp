@@ -0,0 +1,774 @@
+#include "HeapTracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Benchmark/BenchmarkReport.hpp"
+#include "GaugeLoader/CallbackScope.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+#include "GaugeLoader/Watchdog.hpp"
+
+// glibc's own implementations, exported for exactly this kind of wrapper
+extern "C" {
+void *__libc_malloc(size_t size) noexcept;
+void *__libc_calloc(size_t count, size_t size) noexcept;
+void *__libc_realloc(void *ptr, size_t size) noexcept;
+void *__libc_memalign(size_t alignment, size_t size) noexcept;
+void __libc_free(void *ptr) noexcept;
+}
+
+HeapTracker *HeapTracker::m_Instance = nullptr;
+
+// Everything below runs inside malloc: no allocation, no locks, no thread_local with a constructor, and only
+// constant initialized globals since the first malloc comes long before static constructors
+namespace {
+constexpr uint16_t NO_SLOT = UINT16_MAX;
+constexpr uint32_t SLOTS = GaugeArena::CAPACITY;
+
+// glibc keeps the chunk size in the word right before every block it returns. Sizes are multiples of 16 with flags in
+// the low three bits, so bit 3 of that word is always clear, while our tag in the same place has it set. That lets
+// free() pass blocks libc allocated directly (static initializers of a deepbind gauge) straight through.
+constexpr uint16_t BLOCK_TAG = 0x4d48;
+static_assert(BLOCK_TAG & 0x8, "tag must not look like a glibc chunk size");
+constexpr uint64_t MAX_SIZE = (1ull << 40) - 1;
+constexpr size_t MAX_ALIGNMENT = 1u << 23;
+
+struct alignas(16) BlockHeader {
+  uint64_t size : 40;  // as requested
+  uint64_t offset : 24;  // from the start of the glibc block or arena chunk to the user pointer
+  uint16_t tag;
+  uint16_t slot;  // owning gauge, NO_SLOT for emulator allocations
+  uint16_t generation;  // slot generation at allocation time, blocks of a detached gauge no longer count
+  uint16_t arena_class;  // size class + 1 of an arena chunk, 0 for glibc blocks
+};
+static_assert(sizeof(BlockHeader) == 16, "header must keep malloc's 16 byte alignment");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "tag has to overlay the low bits of the chunk size");
+constexpr size_t HEADER_SIZE = sizeof(BlockHeader);
+
+// Written by every thread running gauge callbacks, one line per gauge so parallel updates don't contend
+struct alignas(64) HeapSlot {
+  std::atomic<unsigned long long> ctx;  // 0 when free
+  std::atomic<uint16_t> generation;
+  std::atomic<uintptr_t> code_begin;  // executable segments of the gauge library
+  std::atomic<uintptr_t> code_end;
+  std::atomic<uint64_t> limit_bytes;
+  std::atomic<int64_t> live_bytes;
+  std::atomic<int64_t> live_blocks;
+  std::atomic<uint64_t> peak_bytes;
+  std::atomic<uint64_t> frame_bytes;
+  std::atomic<uint64_t> frame_allocs;
+  std::atomic<uint64_t> total_allocs;
+  std::atomic<uint64_t> failed_allocs;
+};
+constinit HeapSlot s_Slots[SLOTS]{};
+
+// All arenas live in one PROT_NONE reservation, so free() can tell arena blocks apart by address without touching
+// them, even after their arena is gone. Spans are handed out round robin: a stale pointer into a released span is
+// ignored, and a span is only reused after every other one was.
+constexpr size_t ARENA_SPAN = 1ull << 30;  // per gauge, allocations past it fall back to the process heap
+constexpr size_t ARENA_SPANS = 1024;
+constexpr size_t ARENA_GROW = 2u << 20;
+constexpr uint32_t ARENA_CLASSES = 64;
+
+struct Arena {
+  std::atomic<bool> active;
+  std::atomic_flag lock;
+  uint32_t span;
+  char *base;
+  char *bump;  // chunks below it were handed out at least once
+  char *committed;  // readable and writable below it
+  char *end;
+  void *free_lists[ARENA_CLASSES];  // freed chunks per size class, linked through their first word
+  std::atomic<uint64_t> committed_bytes;
+};
+constinit Arena s_Arenas[SLOTS]{};
+constinit std::atomic<uintptr_t> s_Region = 0;
+constinit std::atomic<uint32_t> s_SpanOwner[ARENA_SPANS]{};  // arena slot + 1, 0 when the span is free
+uint32_t s_NextSpan = 0;
+
+// Main thread only, folded by EndFrame
+struct FrameStats {
+  uint64_t frames;
+  uint64_t frame_bytes;
+  uint64_t frame_allocs;
+  uint64_t peak_frame_bytes;
+  uint64_t peak_frame_allocs;
+  uint64_t reported_failures;
+};
+FrameStats s_FrameStats[SLOTS]{};
+
+// Callbacks of one gauge run back to back, so the last lookup almost always hits
+thread_local unsigned long long t_CachedCtx = 0;
+thread_local uint32_t t_CachedSlot = 0;
+
+// Arena chunks are normally taken and returned by one thread at a time, a spin lock is enough. A hung callback must
+// not be abandoned while it holds one: the gauge's static destructors free into the arena on unload and would spin.
+class SpinGuard {
+  public:
+  explicit SpinGuard(std::atomic_flag &flag)
+      : m_Flag(flag) {
+    Watchdog::s_NoAbandon++;
+    while (m_Flag.test_and_set(std::memory_order_acquire)) {
+      while (m_Flag.test(std::memory_order_relaxed)) {
+      }
+    }
+  }
+  ~SpinGuard() {
+    m_Flag.clear(std::memory_order_release);
+    Watchdog::s_NoAbandon--;
+  }
+
+  SpinGuard(const SpinGuard &) = delete;
+  SpinGuard &operator=(const SpinGuard &) = delete;
+
+  private:
+  std::atomic_flag &m_Flag;
+};
+}  // namespace
+
+// Only the gauge's own calls are charged. Whatever libc, the GL driver or the emulator allocate on its behalf (simvar
+// tables, NanoVG buffers, profiler rows) can outlive the gauge and must not run into its limit: a bad_alloc thrown
+// through an extern "C" API entry point terminates.
+static bool is_gauge_caller(const HeapSlot &heap, const void *caller) {
+  const auto pc = reinterpret_cast<uintptr_t>(caller);
+  return pc >= heap.code_begin.load(std::memory_order_relaxed) && pc < heap.code_end.load(std::memory_order_relaxed);
+}
+
+static uint16_t current_slot(uint16_t &generation, const void *caller) {
+  const unsigned long long ctx = CallbackScope::GetCurrentContext();
+  if (ctx == 0) {
+    return NO_SLOT;
+  }
+  uint32_t slot = t_CachedSlot;
+  if (ctx != t_CachedCtx || s_Slots[slot].ctx.load(std::memory_order_acquire) != ctx) {
+    slot = SLOTS;
+    for (uint32_t i = 0; i < SLOTS; i++) {
+      if (s_Slots[i].ctx.load(std::memory_order_acquire) == ctx) {
+        slot = i;
+        break;
+      }
+    }
+    if (slot == SLOTS) {
+      return NO_SLOT;
+    }
+    t_CachedCtx = ctx;
+    t_CachedSlot = slot;
+  }
+  if (!is_gauge_caller(s_Slots[slot], caller)) {
+    return NO_SLOT;
+  }
+  generation = s_Slots[slot].generation.load(std::memory_order_relaxed);
+  return static_cast<uint16_t>(slot);
+}
+
+// Charges the gauge before the block exists so the limit holds under concurrent allocations
+static bool reserve(const uint16_t slot, const size_t size, const bool new_block) {
+  HeapSlot &heap = s_Slots[slot];
+  const auto bytes = static_cast<int64_t>(size);
+  const int64_t live = heap.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  const uint64_t limit = heap.limit_bytes.load(std::memory_order_relaxed);
+  if (limit != 0 && live > static_cast<int64_t>(limit)) {
+    heap.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    heap.failed_allocs.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint64_t peak = heap.peak_bytes.load(std::memory_order_relaxed);
+  while (live > static_cast<int64_t>(peak) &&
+         !heap.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+  }
+  heap.frame_bytes.fetch_add(size, std::memory_order_relaxed);
+  heap.frame_allocs.fetch_add(1, std::memory_order_relaxed);
+  heap.total_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (new_block) {
+    heap.live_blocks.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+static void release(const uint16_t slot, const uint16_t generation, const size_t size, const bool whole_block) {
+  if (slot == NO_SLOT) {
+    return;
+  }
+  HeapSlot &heap = s_Slots[slot];
+  if (heap.generation.load(std::memory_order_relaxed) != generation) {
+    return;
+  }
+  heap.live_bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+  if (whole_block) {
+    heap.live_blocks.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+static BlockHeader *header_of(void *ptr) { return static_cast<BlockHeader *>(ptr) - 1; }
+
+static bool is_tracked(void *ptr) { return header_of(ptr)->tag == BLOCK_TAG; }
+
+static bool in_arena_region(const void *ptr) {
+  const uintptr_t region = s_Region.load(std::memory_order_relaxed);
+  return region != 0 && reinterpret_cast<uintptr_t>(ptr) - region < ARENA_SPAN * ARENA_SPANS;
+}
+
+// Span owner of an arena pointer, 0 once the arena was released
+static uint32_t arena_owner(const void *ptr) {
+  const size_t span = (reinterpret_cast<uintptr_t>(ptr) - s_Region.load(std::memory_order_relaxed)) / ARENA_SPAN;
+  return s_SpanOwner[span].load(std::memory_order_acquire);
+}
+
+// Chunk sizes step through powers of two and the halfway point between them: 32, 48, 64, 96, 128, 192...
+static uint32_t arena_class(size_t bytes, size_t &class_size) {
+  bytes = std::max<size_t>(bytes, 32);
+  const size_t power = std::bit_ceil(bytes);
+  const auto log2 = static_cast<uint32_t>(std::countr_zero(power));
+  if (bytes <= power / 4 * 3) {
+    class_size = power / 4 * 3;
+    return 2 * log2 - 1;
+  }
+  class_size = power;
+  return 2 * log2;
+}
+
+static size_t arena_class_size(const uint32_t index) {
+  const size_t power = size_t{1} << ((index + 1) / 2);
+  return index % 2 ? power / 4 * 3 : power;
+}
+
+static char *arena_allocate(const uint16_t slot, const size_t size, const size_t alignment, const bool zero,
+                            size_t &offset, uint16_t &index) {
+  const size_t padding = alignment <= HEADER_SIZE ? HEADER_SIZE : alignment + HEADER_SIZE;
+  if (size > ARENA_SPAN - padding) {
+    return nullptr;
+  }
+  size_t class_size;
+  const uint32_t size_class = arena_class(size + padding, class_size);
+
+  Arena &arena = s_Arenas[slot];
+  char *chunk;
+  bool fresh = false;
+  {
+    SpinGuard guard(arena.lock);
+    if (void *head = arena.free_lists[size_class]) {
+      std::memcpy(&arena.free_lists[size_class], head, sizeof(void *));
+      chunk = static_cast<char *>(head);
+    } else {
+      if (class_size > static_cast<size_t>(arena.end - arena.bump)) {
+        return nullptr;
+      }
+      if (arena.bump + class_size > arena.committed) {
+        const size_t needed = arena.bump + class_size - arena.committed;
+        const size_t grow = std::min((needed + ARENA_GROW - 1) / ARENA_GROW * ARENA_GROW,
+                                     static_cast<size_t>(arena.end - arena.committed));
+        if (mprotect(arena.committed, grow, PROT_READ | PROT_WRITE) != 0) {
+          return nullptr;
+        }
+        arena.committed += grow;
+        arena.committed_bytes.fetch_add(grow, std::memory_order_relaxed);
+      }
+      chunk = arena.bump;
+      arena.bump += class_size;
+      fresh = true;
+    }
+  }
+  // Fresh pages come zeroed from the kernel
+  if (zero && !fresh) {
+    std::memset(chunk, 0, class_size);
+  }
+  const auto start = reinterpret_cast<uintptr_t>(chunk) + HEADER_SIZE;
+  offset = HEADER_SIZE + ((alignment - start % alignment) % alignment);
+  index = static_cast<uint16_t>(size_class + 1);
+  return chunk;
+}
+
+static void arena_free(void *ptr) {
+  const uint32_t owner = arena_owner(ptr);
+  if (owner == 0) {
+    // Went away with its arena
+    return;
+  }
+  const BlockHeader header = *header_of(ptr);
+  release(header.slot, header.generation, header.size, true);
+  char *chunk = static_cast<char *>(ptr) - header.offset;
+  Arena &arena = s_Arenas[owner - 1];
+  SpinGuard guard(arena.lock);
+  std::memcpy(chunk, &arena.free_lists[header.arena_class - 1], sizeof(void *));
+  arena.free_lists[header.arena_class - 1] = chunk;
+}
+
+// Charged to slot, NO_SLOT for an untracked block
+static void *allocate_for(const uint16_t slot, const uint16_t generation, const size_t size, const size_t alignment,
+                          const bool zero) {
+  if (slot != NO_SLOT && !reserve(slot, size, true)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  char *base = nullptr;
+  size_t offset = 0;
+  uint16_t arena_class = 0;
+  if (slot != NO_SLOT && s_Arenas[slot].active.load(std::memory_order_acquire)) {
+    base = arena_allocate(slot, size, alignment, zero, offset, arena_class);
+  }
+  if (!base) {
+    offset = std::max(alignment, HEADER_SIZE);
+    if (offset == HEADER_SIZE) {
+      base = static_cast<char *>(zero ? __libc_calloc(1, size + HEADER_SIZE) : __libc_malloc(size + HEADER_SIZE));
+    } else {
+      // The header sits in the padding in front of the aligned pointer
+      base = static_cast<char *>(__libc_memalign(alignment, size + offset));
+    }
+  }
+  if (!base) {
+    release(slot, generation, size, true);
+    return nullptr;
+  }
+  void *ptr = base + offset;
+  *header_of(ptr) = BlockHeader{size, offset, BLOCK_TAG, slot, generation, arena_class};
+  return ptr;
+}
+
+static void *allocate(const size_t size, const size_t alignment, const bool zero, const void *caller) {
+  if (size > MAX_SIZE || alignment > MAX_ALIGNMENT) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  uint16_t generation = 0;
+  const uint16_t slot = current_slot(generation, caller);
+  return allocate_for(slot, generation, size, alignment, zero);
+}
+
+static void *allocate_aligned(const size_t alignment, const size_t size, const void *caller) {
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > MAX_ALIGNMENT) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  return allocate(size, alignment, false, caller);
+}
+
+static void *reallocate(void *ptr, const size_t size, const void *caller) {
+  if (!ptr) {
+    return allocate(size, HEADER_SIZE, false, caller);
+  }
+  if (size == 0) {
+    free(ptr);
+    return nullptr;
+  }
+  const bool arena = in_arena_region(ptr);
+  if (arena && arena_owner(ptr) == 0) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  if (!arena && !is_tracked(ptr)) {
+    return __libc_realloc(ptr, size);
+  }
+  if (size > MAX_SIZE) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  // The block keeps its owner whoever resizes it: an emulator string growing inside a callback stays the emulator's, a
+  // gauge's buffer grown by libc on its behalf stays the gauge's
+  BlockHeader header = *header_of(ptr);
+  const bool owned = header.slot != NO_SLOT &&
+      s_Slots[header.slot].generation.load(std::memory_order_relaxed) == header.generation;
+  const bool in_place = arena ? header.offset + size <= arena_class_size(header.arena_class - 1)
+                              : header.offset == HEADER_SIZE;
+  if (!in_place) {
+    // Over-aligned blocks can't go through __libc_realloc without losing the alignment, arena chunks don't grow. The
+    // copy lands in the owner's arena, if it has one.
+    void *moved = owned ? allocate_for(header.slot, header.generation, size, HEADER_SIZE, false)
+                        : allocate_for(NO_SLOT, 0, size, HEADER_SIZE, false);
+    if (moved) {
+      std::memcpy(moved, ptr, std::min<size_t>(size, header.size));
+      free(ptr);
+    }
+    return moved;
+  }
+
+  if (owned && size > header.size && !reserve(header.slot, size - header.size, false)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  char *base = static_cast<char *>(ptr) - HEADER_SIZE;
+  if (!arena) {
+    base = static_cast<char *>(__libc_realloc(base, size + HEADER_SIZE));
+    if (!base) {
+      if (owned && size > header.size) {
+        release(header.slot, header.generation, size - header.size, false);
+      }
+      return nullptr;
+    }
+  }
+  if (owned && size < header.size) {
+    release(header.slot, header.generation, header.size - size, false);
+  }
+  header.size = size;
+  void *moved = base + HEADER_SIZE;
+  *header_of(moved) = header;
+  return moved;
+}
+
+// operator new loops on the new handler and throws once there is none, like libstdc++'s
+static void *allocate_new(const size_t size, const size_t alignment, const void *caller) {
+  for (;;) {
+    if (void *ptr = allocate(size, alignment, false, caller)) {
+      return ptr;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+static void *allocate_new_nothrow(const size_t size, const size_t alignment, const void *caller) noexcept {
+  try {
+    return allocate_new(size, alignment, caller);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+// The caller's address decides whether a block is charged to the gauge, so every entry point passes its own
+// return address down. None of them may be inlined (LTO), the return address would then be the caller's caller.
+#define CALLER __builtin_return_address(0)
+
+extern "C" {
+[[gnu::noinline]] void *malloc(const size_t size) noexcept { return allocate(size, HEADER_SIZE, false, CALLER); }
+
+[[gnu::noinline]] void *calloc(const size_t count, const size_t size) noexcept {
+  size_t total;
+  if (__builtin_mul_overflow(count, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  return allocate(total, HEADER_SIZE, true, CALLER);
+}
+
+void free(void *ptr) noexcept {
+  if (!ptr) {
+    return;
+  }
+  // Checked first, the header of a released arena block is no longer mapped
+  if (in_arena_region(ptr)) {
+    arena_free(ptr);
+    return;
+  }
+  if (!is_tracked(ptr)) {
+    __libc_free(ptr);
+    return;
+  }
+  const BlockHeader *header = header_of(ptr);
+  release(header->slot, header->generation, header->size, true);
+  __libc_free(static_cast<char *>(ptr) - header->offset);
+}
+
+[[gnu::noinline]] void *realloc(void *ptr, const size_t size) noexcept { return reallocate(ptr, size, CALLER); }
+
+[[gnu::noinline]] void *reallocarray(void *ptr, const size_t count, const size_t size) noexcept {
+  size_t total;
+  if (__builtin_mul_overflow(count, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  return reallocate(ptr, total, CALLER);
+}
+
+[[gnu::noinline]] void *memalign(const size_t alignment, const size_t size) noexcept {
+  return allocate_aligned(alignment, size, CALLER);
+}
+
+[[gnu::noinline]] void *aligned_alloc(const size_t alignment, const size_t size) noexcept {
+  return allocate_aligned(alignment, size, CALLER);
+}
+
+[[gnu::noinline]] int posix_memalign(void **out, const size_t alignment, const size_t size) noexcept {
+  if (alignment % sizeof(void *) != 0) {
+    return EINVAL;
+  }
+  const int saved_errno = errno;
+  void *ptr = allocate_aligned(alignment, size, CALLER);
+  if (!ptr) {
+    const int error = errno;
+    errno = saved_errno;
+    return error;
+  }
+  *out = ptr;
+  return 0;
+}
+
+[[gnu::noinline]] void *valloc(const size_t size) noexcept {
+  return allocate_aligned(static_cast<size_t>(getpagesize()), size, CALLER);
+}
+
+[[gnu::noinline]] void *pvalloc(const size_t size) noexcept {
+  const auto page = static_cast<size_t>(getpagesize());
+  if (size > SIZE_MAX - page) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  return allocate_aligned(page, (size + page - 1) & ~(page - 1), CALLER);
+}
+
+size_t malloc_usable_size(void *ptr) noexcept {
+  if (!ptr) {
+    return 0;
+  }
+  if (in_arena_region(ptr)) {
+    return arena_owner(ptr) != 0 ? header_of(ptr)->size : 0;
+  }
+  if (!is_tracked(ptr)) {
+    // A chunk in use spans its own size word, mmapped chunks also the unused prev_size word
+    const uint64_t chunk = static_cast<const uint64_t *>(ptr)[-1];
+    return (chunk & ~uint64_t{7}) - ((chunk & 2) ? 16 : 8);
+  }
+  return header_of(ptr)->size;
+}
+}
+
+// Replaced as well so that a gauge's new expression (std::allocator included, it is inlined into the gauge) reports
+// the gauge as the caller rather than libstdc++
+[[gnu::noinline]] void *operator new(const size_t size) { return allocate_new(size, HEADER_SIZE, CALLER); }
+[[gnu::noinline]] void *operator new[](const size_t size) { return allocate_new(size, HEADER_SIZE, CALLER); }
+[[gnu::noinline]] void *operator new(const size_t size, const std::nothrow_t &) noexcept {
+  return allocate_new_nothrow(size, HEADER_SIZE, CALLER);
+}
+[[gnu::noinline]] void *operator new[](const size_t size, const std::nothrow_t &) noexcept {
+  return allocate_new_nothrow(size, HEADER_SIZE, CALLER);
+}
+[[gnu::noinline]] void *operator new(const size_t size, const std::align_val_t alignment) {
+  return allocate_new(size, static_cast<size_t>(alignment), CALLER);
+}
+[[gnu::noinline]] void *operator new[](const size_t size, const std::align_val_t alignment) {
+  return allocate_new(size, static_cast<size_t>(alignment), CALLER);
+}
+[[gnu::noinline]] void *operator new(const size_t size, const std::align_val_t alignment,
+                                        const std::nothrow_t &) noexcept {
+  return allocate_new_nothrow(size, static_cast<size_t>(alignment), CALLER);
+}
+[[gnu::noinline]] void *operator new[](const size_t size, const std::align_val_t alignment,
+                                        const std::nothrow_t &) noexcept {
+  return allocate_new_nothrow(size, static_cast<size_t>(alignment), CALLER);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { free(ptr); }
+
+#undef CALLER
+
+void HeapTracker::Attach(const unsigned long long ctx, const uintptr_t code_begin, const uintptr_t code_end,
+                         const size_t limit_bytes) {
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    HeapSlot &heap = s_Slots[i];
+    if (heap.ctx.load(std::memory_order_relaxed) != 0) {
+      continue;
+    }
+    heap.code_begin = code_begin;
+    heap.code_end = code_end;
+    heap.limit_bytes = limit_bytes;
+    heap.live_bytes = 0;
+    heap.live_blocks = 0;
+    heap.peak_bytes = 0;
+    heap.frame_bytes = 0;
+    heap.frame_allocs = 0;
+    heap.total_allocs = 0;
+    heap.failed_allocs = 0;
+    s_FrameStats[i] = FrameStats{};
+    // Publishes the reset counters to threads looking the ctx up
+    heap.ctx.store(ctx, std::memory_order_release);
+    return;
+  }
+}
+
+void HeapTracker::SetLimit(const unsigned long long ctx, const size_t limit_bytes) {
+  for (HeapSlot &heap: s_Slots) {
+    if (heap.ctx.load(std::memory_order_relaxed) == ctx) {
+      heap.limit_bytes = limit_bytes;
+      return;
+    }
+  }
+}
+
+std::expected<void, std::string> HeapTracker::CreateArena(const unsigned long long ctx) {
+  uint32_t slot = SLOTS;
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    if (s_Slots[i].ctx.load(std::memory_order_relaxed) == ctx) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == SLOTS) {
+    return std::unexpected("ctx " + std::to_string(ctx) + " is not attached");
+  }
+  if (s_Slots[slot].code_begin >= s_Slots[slot].code_end) {
+    return std::unexpected(std::string("no executable segment found"));
+  }
+
+  uintptr_t region = s_Region.load(std::memory_order_relaxed);
+  if (region == 0) {
+    void *reserved = mmap(nullptr, ARENA_SPAN * ARENA_SPANS, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                          -1, 0);
+    if (reserved == MAP_FAILED) {
+      return std::unexpected(std::string("failed to reserve arena address space: ") + std::strerror(errno));
+    }
+    region = reinterpret_cast<uintptr_t>(reserved);
+    s_Region.store(region, std::memory_order_relaxed);
+  }
+
+  uint32_t span = ARENA_SPANS;
+  for (uint32_t i = 0; i < ARENA_SPANS; i++) {
+    const uint32_t candidate = (s_NextSpan + i) % ARENA_SPANS;
+    if (s_SpanOwner[candidate].load(std::memory_order_relaxed) == 0) {
+      span = candidate;
+      break;
+    }
+  }
+  if (span == ARENA_SPANS) {
+    return std::unexpected(std::string("no free arena span"));
+  }
+  s_NextSpan = span + 1;
+
+  Arena &arena = s_Arenas[slot];
+  arena.span = span;
+  arena.base = reinterpret_cast<char *>(region + span * ARENA_SPAN);
+  arena.bump = arena.base;
+  arena.committed = arena.base;
+  arena.end = arena.base + ARENA_SPAN;
+  std::fill(std::begin(arena.free_lists), std::end(arena.free_lists), nullptr);
+  arena.committed_bytes = 0;
+  s_SpanOwner[span].store(slot + 1, std::memory_order_release);
+  arena.active.store(true, std::memory_order_release);
+  return {};
+}
+
+HeapTracker::Leak HeapTracker::Detach(const unsigned long long ctx) {
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    HeapSlot &heap = s_Slots[i];
+    if (heap.ctx.load(std::memory_order_relaxed) != ctx) {
+      continue;
+    }
+    heap.ctx.store(0, std::memory_order_release);
+    // Blocks still out there are orphaned, their frees no longer touch the counters of the slot's next gauge
+    heap.generation.fetch_add(1, std::memory_order_relaxed);
+    Leak leak{static_cast<uint64_t>(std::max<int64_t>(heap.live_bytes, 0)),
+              static_cast<uint64_t>(std::max<int64_t>(heap.live_blocks, 0)), 0};
+
+    Arena &arena = s_Arenas[i];
+    if (arena.active.load(std::memory_order_relaxed)) {
+      arena.active = false;
+      s_SpanOwner[arena.span].store(0, std::memory_order_release);
+      leak.arena_bytes = arena.committed_bytes.exchange(0);
+      // Drops every page the gauge touched in one call and leaves the span reserved, so nothing else can be mapped
+      // where stale pointers into it still point
+      if (mmap(arena.base, ARENA_SPAN, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) ==
+          MAP_FAILED) {
+        std::cerr << "[Heap] Failed to release arena of ctx " << ctx << ": " << std::strerror(errno) << std::endl;
+      }
+      arena.base = arena.bump = arena.committed = arena.end = nullptr;
+    }
+    return leak;
+  }
+  return Leak{0, 0, 0};
+}
+
+void HeapTracker::EndFrame() {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    HeapSlot &heap = s_Slots[i];
+    const unsigned long long ctx = heap.ctx.load(std::memory_order_relaxed);
+    if (ctx == 0) {
+      continue;
+    }
+    FrameStats &stats = s_FrameStats[i];
+    stats.frames++;
+    stats.frame_bytes = heap.frame_bytes.exchange(0, std::memory_order_relaxed);
+    stats.frame_allocs = heap.frame_allocs.exchange(0, std::memory_order_relaxed);
+    stats.peak_frame_bytes = std::max(stats.peak_frame_bytes, stats.frame_bytes);
+    stats.peak_frame_allocs = std::max(stats.peak_frame_allocs, stats.frame_allocs);
+
+    const uint64_t failures = heap.failed_allocs.load(std::memory_order_relaxed);
+    if (failures != stats.reported_failures) {
+      const std::string gauge = gauge_loader->GetGaugeName(ctx);
+      std::cerr << "[Heap] " << gauge << " hit its " << heap.limit_bytes.load() / 1024 << " KiB limit, "
+                << failures - stats.reported_failures << " allocations refused" << std::endl;
+      stats.reported_failures = failures;
+    }
+  }
+}
+
+std::vector<HeapTracker::Row> HeapTracker::GetRows() const {
+  std::vector<Row> rows;
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    const HeapSlot &heap = s_Slots[i];
+    const unsigned long long ctx = heap.ctx.load(std::memory_order_relaxed);
+    if (ctx == 0) {
+      continue;
+    }
+    const FrameStats &stats = s_FrameStats[i];
+    const Arena &arena = s_Arenas[i];
+    rows.push_back(Row{ctx,
+                       static_cast<uint64_t>(std::max<int64_t>(heap.live_bytes, 0)),
+                       static_cast<uint64_t>(std::max<int64_t>(heap.live_blocks, 0)),
+                       heap.peak_bytes,
+                       heap.limit_bytes,
+                       stats.frame_bytes,
+                       stats.frame_allocs,
+                       stats.peak_frame_bytes,
+                       stats.peak_frame_allocs,
+                       heap.total_allocs,
+                       heap.failed_allocs,
+                       arena.active.load(std::memory_order_relaxed),
+                       arena.committed_bytes});
+  }
+  return rows;
+}
+
+void HeapTracker::Reset() {
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    HeapSlot &heap = s_Slots[i];
+    heap.peak_bytes = static_cast<uint64_t>(std::max<int64_t>(heap.live_bytes, 0));
+    heap.total_allocs = 0;
+    heap.failed_allocs = 0;
+    s_FrameStats[i] = FrameStats{};
+  }
+}
+
+void HeapTracker::Export(BenchmarkReport &report) const {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    const HeapSlot &heap = s_Slots[i];
+    const unsigned long long ctx = heap.ctx.load(std::memory_order_relaxed);
+    if (ctx == 0) {
+      continue;
+    }
+    const std::string gauge = gauge_loader->GetGaugeName(ctx);
+    const std::string prefix = "heap." + gauge;
+    const auto frames = static_cast<double>(std::max<uint64_t>(s_FrameStats[i].frames, 1));
+    report.Add(prefix + ".live_bytes", static_cast<double>(std::max<int64_t>(heap.live_bytes, 0)), "bytes");
+    report.Add(prefix + ".peak_bytes", static_cast<double>(heap.peak_bytes), "bytes");
+    report.Add(prefix + ".allocs_per_frame", static_cast<double>(heap.total_allocs) / frames, "allocs/frame");
+    report.Add(prefix + ".peak_frame_bytes", static_cast<double>(s_FrameStats[i].peak_frame_bytes), "bytes/frame");
+    if (s_Arenas[i].active.load(std::memory_order_relaxed)) {
+      report.Add(prefix + ".arena_committed_bytes", static_cast<double>(s_Arenas[i].committed_bytes), "bytes");
+    }
+  }
+}
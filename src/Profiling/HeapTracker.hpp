@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <vector>
+
+class BenchmarkReport;
+
+// Per-gauge heap accounting. The emulator defines malloc, free, operator new/delete and the rest of the allocator
+// family itself (see HeapTracker.cpp) and forwards to glibc's __libc_* functions. Every block carries a 16 byte header
+// with its size and owner, the owner being the gauge whose own code allocated it while one of its callbacks was running
+// (see CallbackScope). What the emulator allocates in the meantime, inside API calls or around the callback, stays the
+// emulator's and isn't capped, and so does what libc, libstdc++'s out-of-line code or the GL driver allocate for the
+// gauge. Frees are credited back to the owner no matter which thread or callback frees the block. Gauges opened with
+// namespace isolation bring their own libc and bypass the accounting.
+//
+// A gauge can also get an arena: a private mmap'ed heap that serves every allocation its own code makes inside its
+// callbacks, and that is dropped as a whole when the gauge is unloaded, leaks included.
+class HeapTracker {
+  public:
+  static HeapTracker *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new HeapTracker();
+    }
+    return m_Instance;
+  }
+
+  // Main thread, right before the gauge's init. [code_begin, code_end) are the gauge library's executable segments,
+  // only calls made from there are charged to it. limit_bytes of 0 means no cap, otherwise allocations that would take
+  // the gauge's live bytes above it fail like they do when a WASM module hits its memory ceiling: malloc returns null
+  // and new throws std::bad_alloc.
+  void Attach(unsigned long long ctx, uintptr_t code_begin, uintptr_t code_end, size_t limit_bytes);
+  void SetLimit(unsigned long long ctx, size_t limit_bytes);
+  // Main thread, after Attach. Serves every allocation charged to the gauge from a private arena.
+  std::expected<void, std::string> CreateArena(unsigned long long ctx);
+
+  struct Leak {
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t arena_bytes;  // committed arena memory given back
+  };
+  // Main thread, once the library is closed (its static destructors may still free into the arena). Returns what the
+  // gauge still holds and releases its arena; blocks freed later aren't counted anywhere.
+  Leak Detach(unsigned long long ctx);
+
+  // Main thread, once per frame. Closes the per-frame counters and reports gauges that hit their limit
+  void EndFrame();
+
+  struct Row {
+    unsigned long long ctx;
+    uint64_t live_bytes;
+    uint64_t live_blocks;
+    uint64_t peak_bytes;  // high water mark of live_bytes
+    uint64_t limit_bytes;  // 0 when uncapped
+    uint64_t frame_bytes;  // allocated during the last frame
+    uint64_t frame_allocs;
+    uint64_t peak_frame_bytes;
+    uint64_t peak_frame_allocs;
+    uint64_t total_allocs;
+    uint64_t failed_allocs;  // refused because of the limit
+    bool arena;
+    uint64_t arena_bytes;  // committed, grows in 2 MiB steps and never shrinks
+  };
+  std::vector<Row> GetRows() const;
+  // Clears peaks and totals, live bytes stay
+  void Reset();
+
+  // Adds "heap.<gauge>.{live_bytes,peak_bytes,allocs_per_frame,peak_frame_bytes}" for every attached gauge, and
+  // arena_committed_bytes for those with an arena
+  void Export(BenchmarkReport &report) const;
+
+  private:
+  HeapTracker() = default;
+
+  static HeapTracker *m_Instance;
+};
@@ -0,0 +1,227 @@
+#include "PerfCounters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <ranges>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Benchmark/BenchmarkReport.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+
+PerfCounters *PerfCounters::m_Instance = nullptr;
+std::atomic<bool> PerfCounters::s_Enabled = false;
+std::atomic<PerfCounters::Mode> PerfCounters::s_Mode = PerfCounters::Mode::Unknown;
+std::atomic<uint32_t> PerfCounters::s_AvailableMask = 0;
+
+static constexpr std::array<std::pair<uint32_t, uint64_t>, PerfCounters::COUNTERS> HARDWARE_EVENTS = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+static constexpr std::array<std::pair<uint32_t, uint64_t>, PerfCounters::COUNTERS> SOFTWARE_EVENTS = {{
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+}};
+
+static int open_event(const uint32_t type, const uint64_t config, const int group) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  // Page faults and context switches happen in the kernel, only exclude it for hardware events
+  attr.exclude_kernel = type == PERF_TYPE_HARDWARE;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Counts this thread on whichever CPU it runs
+  int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC));
+  if (fd < 0 && !attr.exclude_kernel) {
+    // perf_event_paranoid >= 2 only allows user space counting
+    attr.exclude_kernel = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC));
+  }
+  return fd;
+}
+
+// One counter group per thread that runs gauge callbacks, opened on first use
+struct PerfThreadGroup {
+  int fds[PerfCounters::COUNTERS] = {-1, -1, -1, -1};
+  int slots[PerfCounters::COUNTERS] = {-1, -1, -1, -1};  // position in the group read, -1 if the event is missing
+  int members = 0;
+  bool opened = false;
+
+  ~PerfThreadGroup() {
+    for (const int fd: fds) {
+      if (fd >= 0) close(fd);
+    }
+  }
+
+  bool Open(const std::array<std::pair<uint32_t, uint64_t>, PerfCounters::COUNTERS> &events) {
+    int leader = -1;
+    for (int i = 0; i < PerfCounters::COUNTERS; i++) {
+      const int fd = open_event(events[i].first, events[i].second, leader);
+      if (fd < 0) {
+        // Without the first event (cycles, task clock) the rest is meaningless
+        if (i == 0) return false;
+        continue;
+      }
+      if (leader < 0) leader = fd;
+      fds[i] = fd;
+      slots[i] = members++;
+    }
+    return true;
+  }
+
+  void Ensure() {
+    if (opened) {
+      return;
+    }
+    opened = true;
+
+    PerfCounters::Mode mode = PerfCounters::Mode::Unavailable;
+    if (Open(HARDWARE_EVENTS)) {
+      mode = PerfCounters::Mode::Hardware;
+    } else if (Open(SOFTWARE_EVENTS)) {
+      mode = PerfCounters::Mode::Software;
+    }
+    const int error = errno;
+
+    uint32_t mask = 0;
+    for (int i = 0; i < PerfCounters::COUNTERS; i++) {
+      if (slots[i] >= 0) mask |= 1u << i;
+    }
+    // Every thread ends up in the same mode on one machine, the first one to get here reports it
+    auto expected = PerfCounters::Mode::Unknown;
+    if (PerfCounters::s_Mode.compare_exchange_strong(expected, mode)) {
+      PerfCounters::s_AvailableMask = mask;
+      if (mode == PerfCounters::Mode::Unavailable) {
+        std::cerr << "[Perf] perf_event_open failed (" << std::strerror(error)
+                  << "), check /proc/sys/kernel/perf_event_paranoid; only wall time is recorded" << std::endl;
+      } else if (mode == PerfCounters::Mode::Software) {
+        std::cerr << "[Perf] No hardware counters, falling back to software counters" << std::endl;
+      }
+    }
+  }
+};
+static thread_local PerfThreadGroup t_Group;
+
+const char *PerfCounters::CallbackName(const Callback callback) {
+  switch (callback) {
+    case Callback::Update:
+      return "update";
+    case Callback::Draw:
+      return "draw";
+  }
+  return "";
+}
+
+const std::array<const char *, PerfCounters::COUNTERS> &PerfCounters::CounterNames(const Mode mode) {
+  static constexpr std::array<const char *, COUNTERS> hardware = {"cycles", "instructions", "cache-misses",
+                                                                  "branch-misses"};
+  static constexpr std::array<const char *, COUNTERS> software = {"task-clock", "page-faults", "context-switches",
+                                                                  "cpu-migrations"};
+  return mode == Mode::Software ? software : hardware;
+}
+
+void PerfCounters::Read(Snapshot &snapshot) {
+  t_Group.Ensure();
+  snapshot.has_counters = false;
+  if (t_Group.members > 0) {
+    const int leader = t_Group.fds[0];
+    uint64_t buffer[3 + COUNTERS];
+    const ssize_t size = read(leader, buffer, sizeof(buffer));
+    if (size >= static_cast<ssize_t>((3 + t_Group.members) * sizeof(uint64_t))) {
+      snapshot.time_enabled = buffer[1];
+      snapshot.time_running = buffer[2];
+      for (int i = 0; i < COUNTERS; i++) {
+        snapshot.values[i] = t_Group.slots[i] >= 0 ? buffer[3 + t_Group.slots[i]] : 0;
+      }
+      snapshot.has_counters = true;
+    }
+  }
+  snapshot.wall = std::chrono::steady_clock::now();
+}
+
+void PerfCounters::Add(const unsigned long long ctx, const Callback callback, const Snapshot &start,
+                       const Snapshot &end) {
+  const double wall_ns = std::chrono::duration<double, std::nano>(end.wall - start.wall).count();
+
+  // The kernel multiplexes groups when there are more events than counters, scale up to the full interval
+  std::array<double, COUNTERS> deltas{};
+  const bool has_counters = start.has_counters && end.has_counters;
+  if (has_counters) {
+    const uint64_t enabled = end.time_enabled - start.time_enabled;
+    const uint64_t running = end.time_running - start.time_running;
+    const double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+    for (int i = 0; i < COUNTERS; i++) {
+      deltas[i] = static_cast<double>(end.values[i] - start.values[i]) * scale;
+    }
+  }
+
+  std::lock_guard lock(m_Mutex);
+  auto [it, inserted] = m_Rows.try_emplace((static_cast<uint64_t>(ctx) << 1) | static_cast<uint64_t>(callback));
+  Row &row = it->second;
+  if (inserted) {
+    row.ctx = ctx;
+    row.callback = callback;
+  }
+  row.totals.calls++;
+  row.totals.wall_ns += wall_ns;
+  for (int i = 0; i < COUNTERS; i++) {
+    row.totals.values[i] += deltas[i];
+  }
+}
+
+std::vector<PerfCounters::Row> PerfCounters::GetRows() const {
+  std::lock_guard lock(m_Mutex);
+  std::vector<Row> rows;
+  rows.reserve(m_Rows.size());
+  for (const auto &row: m_Rows | std::views::values) {
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+void PerfCounters::Reset() {
+  std::lock_guard lock(m_Mutex);
+  m_Rows.clear();
+}
+
+void PerfCounters::Export(BenchmarkReport &report) const {
+  auto gauge_loader = GaugeLoader::GetInstance();
+  const Mode mode = GetMode();
+  const auto &names = CounterNames(mode);
+
+  for (const auto &row: GetRows()) {
+    if (row.totals.calls == 0) {
+      continue;
+    }
+    const std::string gauge = gauge_loader->GetGaugeName(row.ctx);
+    const std::string prefix = "perf." + gauge + "." + CallbackName(row.callback);
+    const auto calls = static_cast<double>(row.totals.calls);
+    const auto &values = row.totals.values;
+    report.Add(prefix + ".wall", row.totals.wall_ns / calls / 1000.0, "us/call");
+
+    if (mode == Mode::Hardware) {
+      if (values[0] > 0.0 && IsCounterAvailable(1)) {
+        report.Add(prefix + ".ipc", values[1] / values[0], "instructions/cycle");
+      }
+      if (values[1] > 0.0) {
+        if (IsCounterAvailable(2)) report.Add(prefix + ".cache_mpki", values[2] / values[1] * 1000.0, "misses/kinstr");
+        if (IsCounterAvailable(3)) report.Add(prefix + ".branch_mpki", values[3] / values[1] * 1000.0, "misses/kinstr");
+      }
+    } else if (mode == Mode::Software) {
+      for (int i = 0; i < COUNTERS; i++) {
+        if (IsCounterAvailable(i)) {
+          report.Add(prefix + "." + names[i], values[i] / calls, i == 0 ? "ns/call" : "events/call");
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class BenchmarkReport;
+
+// perf_event_open counters around every gauge update and draw. Each thread that runs gauge callbacks opens one
+// counter group (cycles, instructions, cache misses, branch misses) and reads it before and after the call. Where the
+// PMU isn't available, e.g. most VMs, the group falls back to software counters, and failing that only wall time is
+// kept. Hardware events count user space only, so the default perf_event_paranoid of 2 is enough.
+class PerfCounters {
+  public:
+  static PerfCounters *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new PerfCounters();
+    }
+    return m_Instance;
+  }
+
+  static constexpr int COUNTERS = 4;
+  enum class Mode { Unknown, Hardware, Software, Unavailable };
+  enum class Callback { Update, Draw };
+  static const char *CallbackName(Callback callback);
+  // Counter names of the mode, hardware: cycles, instructions, cache-misses, branch-misses
+  static const std::array<const char *, COUNTERS> &CounterNames(Mode mode);
+
+  struct Snapshot {
+    uint64_t time_enabled;
+    uint64_t time_running;
+    std::array<uint64_t, COUNTERS> values;
+    std::chrono::steady_clock::time_point wall;
+    bool has_counters;
+  };
+
+  // Wraps one gauge callback, costs a relaxed load while counting is off
+  class Measurement {
+    public:
+    Measurement(const unsigned long long ctx, const Callback callback)
+        : m_Ctx(ctx)
+        , m_Callback(callback)
+        , m_Active(s_Enabled.load(std::memory_order_relaxed)) {
+      if (m_Active) {
+        Read(m_Start);
+      }
+    }
+    ~Measurement() {
+      if (m_Active) {
+        Snapshot end;
+        Read(end);
+        GetInstance()->Add(m_Ctx, m_Callback, m_Start, end);
+      }
+    }
+
+    Measurement(const Measurement &) = delete;
+    Measurement &operator=(const Measurement &) = delete;
+
+    private:
+    unsigned long long m_Ctx;
+    Callback m_Callback;
+    bool m_Active;
+    Snapshot m_Start;
+  };
+
+  void SetEnabled(bool enabled) { s_Enabled = enabled; }
+  bool IsEnabled() const { return s_Enabled; }
+  Mode GetMode() const { return s_Mode.load(); }
+  // Some hardware counters can be missing even when the group opened (cache misses on some hybrid cores)
+  bool IsCounterAvailable(int counter) const { return (s_AvailableMask.load() >> counter) & 1; }
+
+  struct Totals {
+    uint64_t calls;
+    double wall_ns;
+    std::array<double, COUNTERS> values;  // scaled up where the kernel multiplexed the group
+  };
+  struct Row {
+    unsigned long long ctx;
+    Callback callback;
+    Totals totals;
+  };
+  std::vector<Row> GetRows() const;
+  void Reset();
+
+  // Adds wall time and derived ratios per gauge and callback as "perf.<gauge>.<update|draw>.*"
+  void Export(BenchmarkReport &report) const;
+
+  private:
+  PerfCounters() = default;
+
+  static void Read(Snapshot &snapshot);
+  void Add(unsigned long long ctx, Callback callback, const Snapshot &start, const Snapshot &end);
+
+  static PerfCounters *m_Instance;
+  static std::atomic<bool> s_Enabled;
+  static std::atomic<Mode> s_Mode;
+  static std::atomic<uint32_t> s_AvailableMask;
+
+  friend struct PerfThreadGroup;
+
+  mutable std::mutex m_Mutex;
+  std::unordered_map<uint64_t, Row> m_Rows;  // <ctx << 1 | callback, Row>
+};
@@ -0,0 +1,298 @@
+#include "SamplingProfiler.hpp"
+
+#include "GaugeLoader/CallbackScope.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+//
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <link.h>
+#include <ranges>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+SamplingProfiler *SamplingProfiler::m_Instance = nullptr;
+
+namespace {
+struct RawSample {
+  unsigned long long ctx;
+  int depth;
+  void *frames[SamplingProfiler::MAX_DEPTH];  // leaf first
+};
+
+// Single producer (the signal handler) and single consumer (Drain), both on the main thread. The handler never
+// writes into [tail, head), so Drain can read those slots even when a signal interrupts it.
+constexpr uint64_t RING_SIZE = 4096;
+RawSample s_Ring[RING_SIZE];
+std::atomic<uint64_t> s_Head = 0;
+std::atomic<uint64_t> s_Tail = 0;
+std::atomic<uint64_t> s_Dropped = 0;
+}  // namespace
+
+static void *interrupted_pc(void *ucontext) {
+#if defined(__x86_64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+  return reinterpret_cast<void *>(static_cast<ucontext_t *>(ucontext)->uc_mcontext.pc);
+#else
+  return nullptr;
+#endif
+}
+
+static void handle_sample_signal(int, siginfo_t *, void *ucontext) {
+  // Emulator code between callbacks isn't interesting, and the ring stays free for gauge samples
+  const unsigned long long ctx = CallbackScope::GetCurrentContext();
+  if (ctx == 0) {
+    return;
+  }
+  const int saved_errno = errno;
+
+  const uint64_t head = s_Head.load(std::memory_order_relaxed);
+  if (head - s_Tail.load(std::memory_order_acquire) >= RING_SIZE) {
+    s_Dropped.fetch_add(1, std::memory_order_relaxed);
+    errno = saved_errno;
+    return;
+  }
+  RawSample &sample = s_Ring[head % RING_SIZE];
+  sample.ctx = ctx;
+
+  // The unwinder walks through the signal trampoline, the interrupted PC marks where the gauge's stack starts
+  void *frames[SamplingProfiler::MAX_DEPTH + 8];
+  const int count = backtrace(frames, SamplingProfiler::MAX_DEPTH + 8);
+  void *pc = interrupted_pc(ucontext);
+  int first = -1;
+  for (int i = 0; i < count; i++) {
+    if (frames[i] == pc) {
+      first = i;
+      break;
+    }
+  }
+  if (first < 0) {
+    sample.frames[0] = pc;
+    sample.depth = 1;
+  } else {
+    sample.depth = std::min(count - first, SamplingProfiler::MAX_DEPTH);
+    std::memcpy(sample.frames, frames + first, sample.depth * sizeof(void *));
+  }
+
+  s_Head.store(head + 1, std::memory_order_release);
+  errno = saved_errno;
+}
+
+static std::string demangle(const char *name) {
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0 || !demangled) {
+    return name;
+  }
+  std::string result(demangled);
+  std::free(demangled);
+  return result;
+}
+
+std::expected<void, std::string> SamplingProfiler::Start(const int frequency) {
+  if (m_Running) {
+    return {};
+  }
+
+  // backtrace() loads libgcc_s on its first call, which must not happen inside the signal handler
+  void *warmup[1];
+  backtrace(warmup, 1);
+
+  struct sigaction action {};
+  action.sa_sigaction = handle_sample_signal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    return std::unexpected(std::string("sigaction failed: ") + std::strerror(errno));
+  }
+
+  // Ticks on the main thread's CPU time and is delivered to the main thread only, idle frames cost no samples
+  sigevent event{};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = gettid();
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &m_Timer) != 0) {
+    return std::unexpected(std::string("timer_create failed: ") + std::strerror(errno));
+  }
+
+  const long interval = 1'000'000'000L / std::clamp(frequency, 1, 10000);
+  const itimerspec spec{{0, interval}, {0, interval}};
+  if (timer_settime(m_Timer, 0, &spec, nullptr) != 0) {
+    const int error = errno;
+    timer_delete(m_Timer);
+    return std::unexpected(std::string("timer_settime failed: ") + std::strerror(error));
+  }
+  m_Running = true;
+  std::cout << "[Profiler] Sampling gauge code at " << frequency << " Hz" << std::endl;
+  return {};
+}
+
+void SamplingProfiler::Stop() {
+  if (!m_Running) {
+    return;
+  }
+  timer_delete(m_Timer);
+  // A signal still pending would otherwise hit the default action and terminate us
+  signal(SIGPROF, SIG_IGN);
+  m_Running = false;
+  Drain();
+}
+
+uint64_t SamplingProfiler::GetDroppedCount() const { return s_Dropped.load(std::memory_order_relaxed); }
+
+void SamplingProfiler::Drain() {
+  const uint64_t head = s_Head.load(std::memory_order_acquire);
+  uint64_t tail = s_Tail.load(std::memory_order_relaxed);
+  if (tail == head) {
+    return;
+  }
+
+  auto gauge_loader = GaugeLoader::GetInstance();
+  std::vector<const std::string *> names;
+  std::string stack;
+  for (; tail != head; ++tail) {
+    const RawSample &sample = s_Ring[tail % RING_SIZE];
+    names.clear();
+    for (int i = 0; i < sample.depth; i++) {
+      // Outer frames hold return addresses, step back into the call instruction
+      const auto pc = reinterpret_cast<uintptr_t>(sample.frames[i]) - (i > 0 ? 1 : 0);
+      names.push_back(&Symbolize(pc));
+    }
+
+    for (size_t i = 0; i < names.size(); i++) {
+      // Recursive functions only count once towards total
+      const auto end = names.begin() + static_cast<long>(i);
+      if (std::find(names.begin(), end, names[i]) != end) {
+        continue;
+      }
+      Function &function = m_Functions[*names[i]];
+      if (function.name.empty()) {
+        function.name = *names[i];
+      }
+      function.total++;
+      if (i == 0) {
+        function.self++;
+      }
+    }
+
+    stack = gauge_loader->GetGaugeName(sample.ctx);
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+      stack += ';';
+      stack += **it;
+    }
+    m_Stacks[stack]++;
+    m_Samples++;
+  }
+  s_Tail.store(head, std::memory_order_release);
+}
+
+void SamplingProfiler::OnGaugeUnloaded() {
+  Drain();
+  m_Symbols.clear();
+  m_Modules.clear();
+}
+
+void SamplingProfiler::Reset() {
+  Drain();
+  m_Functions.clear();
+  m_Stacks.clear();
+  m_Samples = 0;
+  s_Dropped = 0;
+}
+
+const SamplingProfiler::Module *SamplingProfiler::FindModule(const char *path) {
+  if (const auto it = m_Modules.find(path); it != m_Modules.end()) {
+    return it->second.get();
+  }
+
+  std::unique_ptr<Module> module;
+  for (const auto &[name, gauge]: GaugeLoader::GetInstance()->GetAllGauges()) {
+    if (gauge.shadow_path != path) {
+      continue;
+    }
+    link_map *map = nullptr;
+    if (dlinfo(gauge.handle, RTLD_DI_LINKMAP, &map) != 0 || !map) {
+      break;
+    }
+    auto elf = ElfFile::Load(gauge.shadow_path);
+    if (!elf.has_value()) {
+      std::cerr << "[Profiler] No symbols for " << name << ": " << elf.error() << std::endl;
+      break;
+    }
+    module = std::make_unique<Module>(Module{name, static_cast<uintptr_t>(map->l_addr), elf->GetFunctionSymbols()});
+    break;
+  }
+  return m_Modules.emplace(path, std::move(module)).first->second.get();
+}
+
+const std::string &SamplingProfiler::Symbolize(const uintptr_t pc) {
+  if (const auto it = m_Symbols.find(pc); it != m_Symbols.end()) {
+    return it->second;
+  }
+
+  std::string name;
+  Dl_info info{};
+  char offset[32];
+  if (dladdr(reinterpret_cast<void *>(pc), &info) == 0 || !info.dli_fname) {
+    name = "[unknown]";
+  } else if (const Module *module = FindModule(info.dli_fname)) {
+    // dladdr only knows exported symbols, the gauge's own symtab covers static and hidden functions too
+    const uint64_t address = pc - module->base;
+    const auto it = std::ranges::upper_bound(module->functions, address, {}, &ElfFile::FunctionSymbol::address);
+    if (it != module->functions.begin() &&
+        (std::prev(it)->size == 0 || address < std::prev(it)->address + std::prev(it)->size)) {
+      name = module->gauge + "!" + demangle(std::prev(it)->name.c_str());
+    } else {
+      std::snprintf(offset, sizeof(offset), "+0x%llx", static_cast<unsigned long long>(address));
+      name = module->gauge + offset;
+    }
+  } else {
+    const std::string library = std::filesystem::path(info.dli_fname).filename().string();
+    if (info.dli_sname) {
+      name = library + "!" + demangle(info.dli_sname);
+    } else {
+      std::snprintf(offset, sizeof(offset), "+0x%llx",
+                    static_cast<unsigned long long>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+      name = library + offset;
+    }
+  }
+  return m_Symbols.emplace(pc, std::move(name)).first->second;
+}
+
+std::vector<SamplingProfiler::Function> SamplingProfiler::GetTopFunctions(const size_t count) const {
+  std::vector<Function> functions;
+  functions.reserve(m_Functions.size());
+  for (const auto &function: m_Functions | std::views::values) {
+    functions.push_back(function);
+  }
+  const auto middle = functions.begin() + static_cast<long>(std::min(count, functions.size()));
+  std::partial_sort(functions.begin(), middle, functions.end(),
+                    [](const Function &a, const Function &b) { return a.self > b.self; });
+  functions.erase(middle, functions.end());
+  return functions;
+}
+
+std::expected<void, std::string> SamplingProfiler::WriteCollapsed(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return std::unexpected("Failed to open " + path);
+  }
+  for (const auto &[stack, samples]: m_Stacks) {
+    file << stack << ' ' << samples << '\n';
+  }
+  return {};
+}
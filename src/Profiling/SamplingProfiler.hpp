@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <expected>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GaugeLoader/ElfFile.hpp"
+
+// In-process sampling profiler for gauge code on the main thread. A CPU time timer delivers SIGPROF to the main
+// thread, the handler keeps the stack only while a gauge callback is running (see CallbackScope) and writes it to a
+// lock free ring. Drain() symbolizes the ring against the loaded gauge libraries, using their full .symtab so static
+// functions show up too, and folds it into a function table and collapsed stacks for flame graphs.
+// Update callbacks running on the worker pool are not sampled.
+class SamplingProfiler {
+  public:
+  static SamplingProfiler *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new SamplingProfiler();
+    }
+    return m_Instance;
+  }
+
+  // Main thread only, samples per second of main thread CPU time
+  std::expected<void, std::string> Start(int frequency);
+  void Stop();
+  bool IsRunning() const { return m_Running; }
+
+  // Main thread, once per frame and before a gauge library is closed (its PCs can't be symbolized afterwards)
+  void Drain();
+  // Drains, then forgets cached symbols of libraries that are about to go away
+  void OnGaugeUnloaded();
+  void Reset();
+
+  struct Function {
+    std::string name;  // "module!function"
+    uint64_t self;  // samples with this function as the leaf
+    uint64_t total;  // samples with this function anywhere on the stack
+  };
+  std::vector<Function> GetTopFunctions(size_t count) const;
+  uint64_t GetSampleCount() const { return m_Samples; }
+  uint64_t GetDroppedCount() const;  // ring was full, Drain wasn't called often enough
+
+  // Brendan Gregg's collapsed format, "gauge;outer;...;leaf count" per line, for flamegraph.pl or speedscope
+  std::expected<void, std::string> WriteCollapsed(const std::string &path) const;
+
+  static constexpr int MAX_DEPTH = 24;
+
+  // "gauge!function" from the gauge's symtab, "library!symbol" or "library+offset" elsewhere. Main thread, cached
+  // until the next unload.
+  const std::string &Symbolize(uintptr_t pc);
+
+  private:
+  SamplingProfiler() = default;
+
+  struct Module {
+    std::string gauge;
+    uintptr_t base;
+    std::vector<ElfFile::FunctionSymbol> functions;
+  };
+  const Module *FindModule(const char *path);
+
+  static SamplingProfiler *m_Instance;
+
+  timer_t m_Timer{};
+  bool m_Running = false;
+  uint64_t m_Samples = 0;
+  std::unordered_map<uintptr_t, std::string> m_Symbols;  // pc -> "module!function"
+  std::unordered_map<std::string, std::unique_ptr<Module>> m_Modules;  // by path, null for non gauge libraries
+  std::unordered_map<std::string, Function> m_Functions;
+  std::unordered_map<std::string, uint64_t> m_Stacks;  // collapsed stack -> samples
+};
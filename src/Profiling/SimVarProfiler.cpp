@@ -0,0 +1,122 @@
+#include "SimVarProfiler.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <string>
+
+#include "Benchmark/BenchmarkReport.hpp"
+#include "GaugeLoader/GaugeLoader.hpp"
+
+SimVarProfiler *SimVarProfiler::m_Instance = nullptr;
+std::atomic<bool> SimVarProfiler::s_Enabled = false;
+
+namespace {
+// Counters of one thread, also flushed when the thread exits so detached gauge threads aren't lost entirely
+struct ThreadCounters {
+  std::unordered_map<uint64_t, SimVarProfiler::Counts> counts;
+
+  ~ThreadCounters() { SimVarProfiler::FlushThread(); }
+};
+thread_local ThreadCounters t_Counters;
+}  // namespace
+
+uint64_t SimVarProfiler::PackKey(const unsigned long long ctx, const int variable, const int unit) {
+  return (static_cast<uint64_t>(ctx & 0xFFFFFF) << 40) | (static_cast<uint64_t>(variable & 0xFFFFFF) << 16) |
+      static_cast<uint64_t>(unit & 0xFFFF);
+}
+
+void SimVarProfiler::RecordEnabled(const unsigned long long ctx, const int variable, const int unit,
+                                   const Access access) {
+  auto &counts = t_Counters.counts[PackKey(ctx, variable, unit)];
+  if (access == Access::Read) {
+    counts.reads++;
+  } else {
+    counts.writes++;
+  }
+}
+
+void SimVarProfiler::FlushThread() {
+  if (t_Counters.counts.empty()) {
+    return;
+  }
+  GetInstance()->Merge(t_Counters.counts);
+  // clear() keeps the buckets, next frame's accesses to the same rows don't allocate
+  t_Counters.counts.clear();
+}
+
+void SimVarProfiler::Merge(const std::unordered_map<uint64_t, Counts> &counts) {
+  std::lock_guard lock(m_Mutex);
+  for (const auto &[key, value]: counts) {
+    auto &frame = m_Frame[key];
+    frame.reads += value.reads;
+    frame.writes += value.writes;
+  }
+}
+
+void SimVarProfiler::EndFrame() {
+  FlushThread();
+  std::lock_guard lock(m_Mutex);
+  if (!s_Enabled && m_Frame.empty()) {
+    return;
+  }
+  m_Frames++;
+  for (const auto &[key, counts]: m_Frame) {
+    auto [it, inserted] = m_Rows.try_emplace(key);
+    Row &row = it->second;
+    if (inserted) {
+      row.ctx = key >> 40;
+      row.variable = static_cast<int>((key >> 16) & 0xFFFFFF);
+      row.unit = static_cast<int>(key & 0xFFFF);
+    }
+    row.reads += counts.reads;
+    row.writes += counts.writes;
+    row.peak_reads = std::max(row.peak_reads, counts.reads);
+    row.peak_writes = std::max(row.peak_writes, counts.writes);
+  }
+  m_Frame.clear();
+}
+
+void SimVarProfiler::Reset() {
+  t_Counters.counts.clear();
+  std::lock_guard lock(m_Mutex);
+  m_Frame.clear();
+  m_Rows.clear();
+  m_Frames = 0;
+}
+
+std::vector<SimVarProfiler::Row> SimVarProfiler::GetRows() const {
+  std::lock_guard lock(m_Mutex);
+  std::vector<Row> rows;
+  rows.reserve(m_Rows.size());
+  for (const auto &row: m_Rows | std::views::values) {
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+uint64_t SimVarProfiler::GetFrames() const {
+  std::lock_guard lock(m_Mutex);
+  return m_Frames;
+}
+
+void SimVarProfiler::Export(BenchmarkReport &report, const size_t max_rows) const {
+  auto rows = GetRows();
+  const double frames = static_cast<double>(std::max<uint64_t>(GetFrames(), 1));
+  std::ranges::sort(rows, [](const Row &a, const Row &b) { return a.reads + a.writes > b.reads + b.writes; });
+  if (rows.size() > max_rows) {
+    rows.resize(max_rows);
+  }
+
+  auto gauge_loader = GaugeLoader::GetInstance();
+  for (const auto &row: rows) {
+    const std::string gauge = gauge_loader->GetGaugeName(row.ctx);
+    const std::string variable = static_cast<size_t>(row.variable) < gauge_loader->GetVariableCount()
+        ? gauge_loader->GetVariableName(row.variable)
+        : "#" + std::to_string(row.variable);
+    const std::string prefix = "simvar_access." + gauge + "." + variable;
+    report.Add(prefix + ".reads", static_cast<double>(row.reads) / frames, "reads/frame");
+    report.Add(prefix + ".peak_reads", static_cast<double>(row.peak_reads), "reads/frame");
+    report.Add(prefix + ".writes", static_cast<double>(row.writes) / frames, "writes/frame");
+    report.Add(prefix + ".peak_writes", static_cast<double>(row.peak_writes), "writes/frame");
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "GaugeLoader/CallbackScope.hpp"
+
+class BenchmarkReport;
+
+// Counts fsVars* gets and sets per (gauge ctx, variable, unit). Every thread counts into its own thread_local table
+// without locking; update jobs and the main thread hand their tables over once per frame, so the cost of a recorded
+// access is one hash lookup. Off until enabled in the Instrumentation window.
+class SimVarProfiler {
+  public:
+  static SimVarProfiler *GetInstance() {
+    if (!m_Instance) {
+      m_Instance = new SimVarProfiler();
+    }
+    return m_Instance;
+  }
+
+  enum class Access { Read, Write };
+
+  static void Record(const int variable, const int unit, const Access access) {
+    if (s_Enabled.load(std::memory_order_relaxed)) {
+      RecordEnabled(CallbackScope::GetCurrentContext(), variable, unit, access);
+    }
+  }
+  // Hands the calling thread's counters to the current frame, cheap when nothing was recorded
+  static void FlushThread();
+
+  void SetEnabled(bool enabled) { s_Enabled = enabled; }
+  bool IsEnabled() const { return s_Enabled; }
+
+  // Main thread, once per frame: closes the frame that just ended and folds it into the per-row statistics
+  void EndFrame();
+  void Reset();
+
+  struct Row {
+    unsigned long long ctx;  // 0 for accesses from outside gauge callbacks (the UI)
+    int variable;
+    int unit;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t peak_reads;  // most reads of this row within one frame
+    uint64_t peak_writes;
+  };
+  std::vector<Row> GetRows() const;
+  uint64_t GetFrames() const;
+
+  // Adds reads/writes per frame of the busiest rows as "simvar_access.<gauge>.<variable>.*"
+  void Export(BenchmarkReport &report, size_t max_rows = 64) const;
+
+  struct Counts {
+    uint64_t reads;
+    uint64_t writes;
+  };
+
+  private:
+  SimVarProfiler() = default;
+
+  static void RecordEnabled(unsigned long long ctx, int variable, int unit, Access access);
+  static uint64_t PackKey(unsigned long long ctx, int variable, int unit);
+  void Merge(const std::unordered_map<uint64_t, Counts> &counts);
+
+  static SimVarProfiler *m_Instance;
+  static std::atomic<bool> s_Enabled;
+
+  mutable std::mutex m_Mutex;
+  std::unordered_map<uint64_t, Counts> m_Frame;  // flushed but not yet folded
+  std::unordered_map<uint64_t, Row> m_Rows;
+  uint64_t m_Frames = 0;
+};
@@ -0,0 +1,182 @@
+#include "TrigramIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+static constexpr uint32_t pack_trigram(const char *text) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16 |
+      static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8 |
+      static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+std::string TrigramIndex::Normalize(std::string_view text) {
+  std::string key(text);
+  std::ranges::transform(key, key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return key;
+}
+
+void TrigramIndex::ExtractTrigrams(std::string_view key, std::vector<uint32_t> &out) {
+  out.clear();
+  if (key.size() < 3) {
+    return;
+  }
+  for (size_t i = 0; i + 3 <= key.size(); ++i) {
+    out.push_back(pack_trigram(key.data() + i));
+  }
+  std::ranges::sort(out);
+  const auto [first, last] = std::ranges::unique(out);
+  out.erase(first, last);
+}
+
+void TrigramIndex::Add(int id, std::string_view text) {
+  if (id < 0) {
+    return;
+  }
+  if (Contains(id)) {
+    Remove(id);
+  }
+  if (id >= static_cast<int>(m_Keys.size())) {
+    m_Keys.resize(id + 1, KeyRef{0, 0});
+    m_Live.resize(id + 1, false);
+    m_Hits.resize(id + 1, 0);
+  }
+  const std::string key = Normalize(text);
+  m_Keys[id] = KeyRef{static_cast<uint32_t>(m_KeyData.size()), static_cast<uint32_t>(key.size())};
+  m_KeyData += key;
+  m_Live[id] = true;
+  m_Size++;
+  m_Revision++;
+
+  std::vector<uint32_t> trigrams;
+  ExtractTrigrams(key, trigrams);
+  for (const uint32_t trigram: trigrams) {
+    auto &postings = m_Postings[trigram];
+    // Ids are handed out in increasing order so this is almost always a plain append
+    if (postings.empty() || postings.back() < id) {
+      postings.push_back(id);
+    } else {
+      postings.insert(std::ranges::lower_bound(postings, id), id);
+    }
+  }
+}
+
+void TrigramIndex::Remove(int id) {
+  if (!Contains(id)) {
+    return;
+  }
+  std::vector<uint32_t> trigrams;
+  ExtractTrigrams(GetKey(id), trigrams);
+  for (const uint32_t trigram: trigrams) {
+    const auto it = m_Postings.find(trigram);
+    if (it == m_Postings.end()) {
+      continue;
+    }
+    auto &postings = it->second;
+    if (const auto pos = std::ranges::lower_bound(postings, id); pos != postings.end() && *pos == id) {
+      postings.erase(pos);
+    }
+    if (postings.empty()) {
+      m_Postings.erase(it);
+    }
+  }
+  m_DeadBytes += m_Keys[id].length;
+  m_Keys[id] = KeyRef{0, 0};
+  m_Live[id] = false;
+  m_Size--;
+  m_Revision++;
+
+  if (m_DeadBytes > m_KeyData.size() / 2) {
+    Compact();
+  }
+}
+
+void TrigramIndex::Compact() {
+  std::string data;
+  data.reserve(m_KeyData.size() - m_DeadBytes);
+  for (int id = 0; id < static_cast<int>(m_Keys.size()); ++id) {
+    if (!m_Live[id]) {
+      continue;
+    }
+    const std::string_view key = GetKey(id);
+    m_Keys[id].offset = static_cast<uint32_t>(data.size());
+    data += key;
+  }
+  m_KeyData = std::move(data);
+  m_DeadBytes = 0;
+}
+
+uint32_t TrigramIndex::RankBonus(std::string_view key, std::string_view query) {
+  uint32_t bonus = 0;
+  if (const size_t pos = key.find(query); pos != std::string_view::npos) {
+    bonus += SCORE_SCALE;
+    if (pos == 0) {
+      bonus += SCORE_SCALE / 2;
+    } else if (const char before = key[pos - 1]; before == ' ' || before == ':' || before == '_') {
+      bonus += SCORE_SCALE / 4;
+    }
+  }
+  // Prefer the shorter name when everything else is equal
+  return bonus + MAX_LENGTH_BONUS - std::min<uint32_t>(static_cast<uint32_t>(key.size()), MAX_LENGTH_BONUS);
+}
+
+void TrigramIndex::ScanSubstring(std::string_view query) {
+  for (int id = 0; id < static_cast<int>(m_Keys.size()); ++id) {
+    if (m_Live[id]) {
+      if (const std::string_view key = GetKey(id); key.find(query) != std::string_view::npos) {
+        m_Scored.push_back(ScoredId{id, RankBonus(key, query)});
+      }
+    }
+  }
+}
+
+void TrigramIndex::Query(std::string_view query, std::vector<Match> &out) {
+  out.clear();
+  m_Scored.clear();
+  const std::string key = Normalize(query);
+  if (key.empty()) {
+    return;
+  }
+
+  ExtractTrigrams(key, m_QueryTrigrams);
+  if (m_QueryTrigrams.empty()) {
+    // One or two characters carry no trigram, a straight substring scan is still well under a millisecond
+    ScanSubstring(key);
+  } else {
+    for (const uint32_t trigram: m_QueryTrigrams) {
+      const auto it = m_Postings.find(trigram);
+      if (it == m_Postings.end()) {
+        continue;
+      }
+      for (const int id: it->second) {
+        if (m_Hits[id]++ == 0) {
+          m_Touched.push_back(id);
+        }
+      }
+    }
+
+    // Require half the query's trigrams, enough to survive a typo or two without matching everything
+    const auto total = static_cast<uint32_t>(m_QueryTrigrams.size());
+    const uint32_t required = (total + 1) / 2;
+    for (const int id: m_Touched) {
+      if (m_Hits[id] >= required) {
+        m_Scored.push_back(ScoredId{id, m_Hits[id] * SCORE_SCALE / total + RankBonus(GetKey(id), key)});
+      }
+      m_Hits[id] = 0;
+    }
+    m_Touched.clear();
+  }
+
+  // Scores are small integers, a stable counting sort beats a comparison sort by a wide margin on big result sets
+  m_Buckets.assign(MAX_SCORE + 2, 0);
+  for (const auto &scored: m_Scored) {
+    m_Buckets[MAX_SCORE - scored.score + 1]++;
+  }
+  for (size_t i = 1; i < m_Buckets.size(); ++i) {
+    m_Buckets[i] += m_Buckets[i - 1];
+  }
+  out.resize(m_Scored.size());
+  for (const auto &scored: m_Scored) {
+    out[m_Buckets[MAX_SCORE - scored.score]++] =
+        Match{scored.id, static_cast<float>(scored.score) / static_cast<float>(SCORE_SCALE)};
+  }
+}
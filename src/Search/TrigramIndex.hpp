@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Incremental trigram index over short names (simvar names). Every lower cased name is split into its distinct
+// trigrams, each trigram keeps a sorted posting list of ids. A query counts how many of its trigrams each id shares,
+// so typos and reordered words still match, then ranks the candidates with substring and prefix bonuses.
+class TrigramIndex {
+  public:
+  struct Match {
+    int id;
+    float score;
+  };
+
+  void Add(int id, std::string_view text);
+  void Remove(int id);
+  bool Contains(int id) const { return id >= 0 && id < static_cast<int>(m_Live.size()) && m_Live[id]; }
+
+  // Ranked best first. Not thread safe, the scratch buffers are reused between calls.
+  void Query(std::string_view query, std::vector<Match> &out);
+
+  std::string_view GetKey(int id) const { return {m_KeyData.data() + m_Keys[id].offset, m_Keys[id].length}; }
+  size_t GetSize() const { return m_Size; }
+  // Bumped on every add/remove so views can tell when their cached results went stale
+  uint64_t GetRevision() const { return m_Revision; }
+
+  private:
+  static std::string Normalize(std::string_view text);
+  static void ExtractTrigrams(std::string_view key, std::vector<uint32_t> &out);
+  void Compact();
+  struct ScoredId {
+    int id;
+    uint32_t score;
+  };
+
+  // Trigram overlap contributes up to SCORE_SCALE, a substring hit another SCORE_SCALE plus up to half of it for a
+  // prefix, and shorter names win ties
+  static constexpr uint32_t SCORE_SCALE = 1000;
+  static constexpr uint32_t MAX_LENGTH_BONUS = 255;
+  static constexpr uint32_t MAX_SCORE = SCORE_SCALE * 5 / 2 + MAX_LENGTH_BONUS;
+
+  struct KeyRef {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  static uint32_t RankBonus(std::string_view key, std::string_view query);
+  void ScanSubstring(std::string_view query);
+
+  private:
+  // Lower cased names live back to back in one buffer so substring scans walk memory linearly. Removed names leave a
+  // hole that is only reclaimed when the buffer is compacted.
+  std::string m_KeyData;
+  std::vector<KeyRef> m_Keys;
+  size_t m_DeadBytes = 0;
+  std::vector<bool> m_Live;
+  std::unordered_map<uint32_t, std::vector<int>> m_Postings;
+  size_t m_Size = 0;
+  uint64_t m_Revision = 0;
+
+  // Query scratch
+  std::vector<uint16_t> m_Hits;
+  std::vector<int> m_Touched;
+  std::vector<uint32_t> m_QueryTrigrams;
+  std::vector<ScoredId> m_Scored;
+  std::vector<uint32_t> m_Buckets;
+};
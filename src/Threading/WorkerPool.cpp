@@ -0,0 +1,150 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+WorkerPool::WorkerPool(unsigned worker_count) {
+  if (worker_count == 0) {
+    worker_count = 1;
+  }
+  // One extra slot for the thread that helps out in Wait()
+  for (unsigned i = 0; i < worker_count + 1; ++i) {
+    m_Workers.push_back(std::make_unique<Worker>());
+  }
+  m_LastSample = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < worker_count; ++i) {
+    m_Workers[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::scoped_lock lock(m_SleepMutex);
+    m_Stop = true;
+  }
+  m_WakeCondition.notify_all();
+  for (auto &worker: m_Workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+void WorkerPool::Submit(Task task) {
+  const unsigned thread_count = static_cast<unsigned>(m_Workers.size()) - 1;
+  const unsigned index = m_NextWorker.fetch_add(1, std::memory_order_relaxed) % thread_count;
+  m_Pending.fetch_add(1, std::memory_order_acq_rel);
+  {
+    std::scoped_lock lock(m_Workers[index]->mutex);
+    m_Workers[index]->tasks.push_back(task);
+  }
+  {
+    std::scoped_lock lock(m_SleepMutex);
+    m_Queued.fetch_add(1, std::memory_order_release);
+  }
+  m_WakeCondition.notify_one();
+}
+
+void WorkerPool::Wait() {
+  const unsigned self = static_cast<unsigned>(m_Workers.size()) - 1;
+  Task task{};
+  while (m_Pending.load(std::memory_order_acquire) > 0) {
+    if (TrySteal(self, task)) {
+      Execute(*m_Workers[self], task);
+      continue;
+    }
+    // Nothing left to steal, the remaining tasks are already running on workers
+    std::unique_lock lock(m_SleepMutex);
+    m_DoneCondition.wait(lock, [this]() { return m_Pending.load(std::memory_order_acquire) == 0; });
+  }
+}
+
+std::vector<WorkerPool::WorkerStats> WorkerPool::SampleStats() {
+  const auto now = std::chrono::steady_clock::now();
+  const double wall_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_LastSample).count());
+  m_LastSample = now;
+
+  std::vector<WorkerStats> stats;
+  stats.reserve(m_Workers.size());
+  for (auto &worker: m_Workers) {
+    const uint64_t busy = worker->busy_ns.load(std::memory_order_relaxed);
+    const uint64_t tasks = worker->tasks_run.load(std::memory_order_relaxed);
+    const uint64_t steals = worker->steals.load(std::memory_order_relaxed);
+
+    const double busy_delta = static_cast<double>(busy - worker->sampled_busy_ns);
+    stats.push_back(WorkerStats{
+        busy_delta / 1e6,
+        wall_ns > 0.0 ? std::min(1.0, busy_delta / wall_ns) : 0.0,
+        tasks - worker->sampled_tasks,
+        steals - worker->sampled_steals,
+    });
+
+    worker->sampled_busy_ns = busy;
+    worker->sampled_tasks = tasks;
+    worker->sampled_steals = steals;
+  }
+  return stats;
+}
+
+void WorkerPool::WorkerLoop(unsigned index) {
+  Worker &worker = *m_Workers[index];
+  Task task{};
+  while (true) {
+    if (TryPop(index, task) || TrySteal(index, task)) {
+      Execute(worker, task);
+      continue;
+    }
+
+    std::unique_lock lock(m_SleepMutex);
+    m_WakeCondition.wait(lock, [this]() { return m_Stop.load() || m_Queued.load(std::memory_order_acquire) > 0; });
+    if (m_Stop) {
+      return;
+    }
+  }
+}
+
+bool WorkerPool::TryPop(unsigned index, Task &task) {
+  Worker &worker = *m_Workers[index];
+  std::scoped_lock lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = worker.tasks.back();
+  worker.tasks.pop_back();
+  m_Queued.fetch_sub(1, std::memory_order_acq_rel);
+  return true;
+}
+
+bool WorkerPool::TrySteal(unsigned thief, Task &task) {
+  const unsigned count = static_cast<unsigned>(m_Workers.size());
+  for (unsigned offset = 1; offset < count; ++offset) {
+    Worker &victim = *m_Workers[(thief + offset) % count];
+    std::scoped_lock lock(victim.mutex);
+    if (victim.tasks.empty()) {
+      continue;
+    }
+    task = victim.tasks.front();
+    victim.tasks.pop_front();
+    m_Queued.fetch_sub(1, std::memory_order_acq_rel);
+    m_Workers[thief]->steals.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+void WorkerPool::Execute(Worker &worker, const Task &task) {
+  const uint64_t start = now_ns();
+  task.func(task.arg);
+  worker.busy_ns.fetch_add(now_ns() - start, std::memory_order_relaxed);
+  worker.tasks_run.fetch_add(1, std::memory_order_relaxed);
+
+  if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::scoped_lock lock(m_SleepMutex);
+    m_DoneCondition.notify_all();
+  }
+}
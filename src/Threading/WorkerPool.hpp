@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing pool used to fan gauge callbacks out across cores. Every worker owns a deque: it pops its own
+// work LIFO and steals from the other workers FIFO once it runs dry. The thread calling Wait() helps drain the queues,
+// so a barrier never leaves a core idle.
+class WorkerPool {
+  public:
+  struct Task {
+    void (*func)(void *);
+    void *arg;
+  };
+
+  struct WorkerStats {
+    double busy_ms;
+    double utilization;  // busy time / wall time since the previous SampleStats() call, 0..1
+    uint64_t tasks;
+    uint64_t steals;
+  };
+
+  explicit WorkerPool(unsigned worker_count);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  void Submit(Task task);
+  void Wait();
+
+  unsigned GetWorkerCount() const { return static_cast<unsigned>(m_Workers.size()); }
+
+  // Per worker stats since the previous call, the last entry is the thread blocked in Wait()
+  std::vector<WorkerStats> SampleStats();
+
+  private:
+  struct alignas(64) Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+
+    std::atomic<uint64_t> busy_ns{0};
+    std::atomic<uint64_t> tasks_run{0};
+    std::atomic<uint64_t> steals{0};
+    uint64_t sampled_busy_ns = 0;
+    uint64_t sampled_tasks = 0;
+    uint64_t sampled_steals = 0;
+  };
+
+  void WorkerLoop(unsigned index);
+  bool TryPop(unsigned index, Task &task);
+  bool TrySteal(unsigned thief, Task &task);
+  void Execute(Worker &worker, const Task &task);
+
+  private:
+  // The last slot, m_Workers.size() - 1, belongs to the thread calling Wait()
+  std::vector<std::unique_ptr<Worker>> m_Workers;
+  std::atomic<unsigned> m_NextWorker{0};
+
+  std::atomic<uint32_t> m_Queued{0};
+  std::atomic<uint32_t> m_Pending{0};
+  std::atomic<bool> m_Stop{false};
+
+  std::mutex m_SleepMutex;
+  std::condition_variable m_WakeCondition;
+  std::condition_variable m_DoneCondition;
+
+  std::chrono::steady_clock::time_point m_LastSample;
+};
@@ -2,17 +2,19 @@
 
 #include "Application/Application.hpp"
 #include "Application/Layer.hpp"
+#include "Benchmark/BenchmarkReport.hpp"
+#include "Benchmark/ReloadSoak.hpp"
 #include "FileDialog/FileDialog.hpp"
+#include "GaugeLoader/FaultGuard.hpp"
+#include "GaugeLoader/GaugeHost.hpp"
+#include "GaugeLoader/Watchdog.hpp"
 #include "GaugeLoader/GaugeLoader.hpp"
-
-struct VariableConfig {
-  float value;
-  float min = -100.0f;
-  float max = 100.0f;
-  bool show_config = false;
-};
-
-static std::unordered_map<std::string, VariableConfig> variable_configs;
+#include "Panels/InstrumentationPanel.hpp"
+#include "Panels/PlotPanel.hpp"
+#include "Panels/SimVarsPanel.hpp"
+#include "Profiling/HeapTracker.hpp"
+#include "Profiling/SamplingProfiler.hpp"
+#include "Profiling/SimVarProfiler.hpp"
 
 class RenderLayer : public Layer {
   public:
@@ -32,26 +34,9 @@ class RenderLayer : public Layer {
     ImGui::SameLine();
     auto file_name = FileDialog::GetFileName(selected_file);
 
-    if (GaugeLoader::GetInstance()->IsUpdateQueued()) {
-      if (!selected_file.empty()) {
-        try {
-          GaugeLoader::GetInstance()->GetOrLoadGauge(selected_file, file_name);
-
-        } catch (const std::exception &e) {
-          std::cerr << "Error loading gauge: " << e.what() << std::endl;
-        }
-        GaugeLoader::GetInstance()->SetUpdateQueued(false);
-      }
-    }
-    ImGui::SameLine();
     if (ImGui::Button("Load Gauge")) {
       if (!selected_file.empty()) {
-        try {
-          GaugeLoader::GetInstance()->GetOrLoadGauge(selected_file, file_name);
-
-        } catch (const std::exception &e) {
-          std::cerr << "Error loading gauge: " << e.what() << std::endl;
-        }
+        GaugeLoader::GetInstance()->RequestLoad(selected_file, file_name);
       }
     }
     ImGui::SameLine();
@@ -63,61 +48,83 @@ class RenderLayer : public Layer {
       }
     }
     ImGui::Text(selected_file.c_str());
-    ImGui::Begin("SimVars");
-    ImGui::Text("SimVar Name    |     Value");
-
-    auto gauge_loader = GaugeLoader::GetInstance();
-    auto variables = gauge_loader->GetVariables();
-    int index = 0;
-
-    for (const auto &variable: variables) {
-      const std::string &name = variable.first;
-      float current_value = variable.second;
-
-      auto &config = variable_configs[name];
-      config.value = current_value;
-
-      std::string slider_label = "##Slider" + name;
-      std::string button_label = "Config##" + name;
-
-      ImGui::Text(name.c_str());
-      ImGui::SliderFloat(slider_label.c_str(), &config.value, config.min, config.max, "%.3f");
-      ImGui::SameLine();
+    RenderPendingLoads();
+    m_SimVarsPanel.Render();
+    m_PlotPanel.Render(glfwGetTime());
+    InstrumentationPanel::Render();
+  }
 
-      if (ImGui::Button(button_label.c_str())) {
-        config.show_config = !config.show_config;
-      }
+  void OnDetach() override {}
 
-      if (config.show_config) {
-        std::string config_window_label = "Config##Window_" + name;
-        ImGui::Begin(config_window_label.c_str(), &config.show_config);
-        ImGui::InputFloat("Min", &config.min);
-        ImGui::InputFloat("Max", &config.max);
-        ImGui::End();
-      }
+  void OnUpdate(float ts) override {
+    // Closes the previous frame, its draws included
+    SimVarProfiler::GetInstance()->EndFrame();
+    SamplingProfiler::GetInstance()->Drain();
+    HeapTracker::GetInstance()->EndFrame();
+    GaugeLoader::GetInstance()->UpdateGauges(ts);
+    m_PlotPanel.Sample(glfwGetTime());
+  }
 
-      ImGui::Separator();
-      gauge_loader->UpdateVariable(index, config.value);
-      index++;
+  private:
+  static void RenderPendingLoads() {
+    const auto loader = GaugeLoader::GetInstance();
+    for (const auto &pending: loader->GetPendingLoads()) {
+      using Phase = GaugeLoader::PendingLoad::Phase;
+      const Phase phase = pending->phase;
+      const float progress = static_cast<float>(phase) / static_cast<float>(Phase::Initializing);
+      const std::string label = pending->gauge_name + ": " + GaugeLoader::PendingLoad::PhaseName(phase);
+      ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f), label.c_str());
+    }
+    if (!loader->GetLastLoadError().empty()) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", loader->GetLastLoadError().c_str());
+    }
+    for (const auto &[name, fault]: loader->GetFaults()) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s crashed (%s), rebuild it to reload", name.c_str(),
+                         fault.c_str());
     }
-
-    ImGui::End();
   }
 
-  void OnDetach() override {}
-
-  void OnUpdate(float ts) override { GaugeLoader::GetInstance()->UpdateGauges(ts); }
+  PlotPanel m_PlotPanel;
+  SimVarsPanel m_SimVarsPanel{m_PlotPanel};
 };
 
 int EntryPoint(const int argc, char **argv) {
+  const auto soak = ReloadSoak::ParseArgs(argc, argv);
+  if (!soak.has_value()) {
+    std::cerr << soak.error() << std::endl;
+    return -1;
+  }
+  // Before any gauge code can run, init of the first gauge included
+  FaultGuard::Install();
+  if (auto watchdog = Watchdog::GetInstance()->Start(); !watchdog.has_value()) {
+    std::cerr << "[Watchdog] Not watching gauge callbacks: " << watchdog.error() << std::endl;
+  }
   auto app = Application::CreateApplication(argc, argv, std::make_unique<RenderLayer>());
   if (!app) {
     std::cerr << "Failed to create application" << std::endl;
     return -1;
   }
+  // A process isolated gauge's host, started by the emulator with the hidden window as its GL context
+  if (GaugeHost::IsHostCommandLine(argc, argv)) {
+    return GaugeHost::RunChild(argc, argv);
+  }
+  if (soak->has_value()) {
+    // Headless: the hidden window only provides the GL context, exits 2 when something leaked
+    auto report = BenchmarkReport::GetInstance();
+    const auto summary = ReloadSoak::Run(soak->value(), *report);
+    if (!summary.has_value()) {
+      std::cerr << "[Soak] " << summary.error() << std::endl;
+      return 1;
+    }
+    if (auto written = report->WriteJson(soak->value().report_path); !written.has_value()) {
+      std::cerr << "[Soak] " << written.error() << std::endl;
+    }
+    return summary->leaks.empty() ? 0 : 2;
+  }
   app->Run();
+  return 0;
 }
 
 extern "C" void Linkage() { std::cerr << "WARNING: Dummy Linkage() called (this may cause issues!)" << std::endl; }
 
-int main(const int argc, char **argv) { EntryPoint(argc, argv); }
+int main(const int argc, char **argv) { return EntryPoint(argc, argv); }